@@ -1,6 +1,6 @@
 //
-// blocking_tcp_echo_client.cpp
-// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// echo_client.cpp
+// ~~~~~~~~~~~~~~~
 //
 // Copyright (c) 2003-2021 Christopher M. Kohlhoff (chris at kohlhoff dot com)
 //
@@ -8,20 +8,167 @@
 // file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
 //
 
+// Without further arguments, sends one line read from stdin and prints the
+// reply. With <connections> <message-size> <pipeline>, runs a load test:
+// each connection is served by two fibers, one writing messages of
+// message-size bytes while at most pipeline of them are unanswered, the
+// other reading the echoes. When the test ends, the requests/s and the
+// latency percentiles (from writing a message to having read its echo
+// completely) are printed.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <deque>
 #include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
 
 #include <boost/asio.hpp>
 
+#include <boost/spawn.hpp>
+#include <boost/spawn/semaphore.hpp>
+
 using boost::asio::ip::tcp;
+using clock_type = std::chrono::steady_clock;
 
 enum { max_length = 1024 };
 
+struct load_options {
+    std::size_t                 connections;
+    std::size_t                 message_size;
+    std::size_t                 pipeline;
+    clock_type::duration        duration;
+};
+
+// state shared by the writer and the reader fiber of a connection; both run
+// in the connection's strand
+struct connection {
+    connection(boost::asio::io_context& io_context, load_options const& opts) :
+        socket(io_context),
+        window(opts.pipeline),
+        message(opts.message_size, 'x'),
+        reply(opts.message_size) {
+    }
+
+    tcp::socket                                 socket;
+    // messages that may still be written before the oldest one is answered
+    boost::spawn::semaphore                     window;
+    std::vector<char>                           message;
+    std::vector<char>                           reply;
+    // time each unanswered message was written
+    std::deque<clock_type::time_point>          sent;
+    std::vector<clock_type::duration>           latencies;
+    bool                                        failed = false;
+};
+
+void write_messages(std::shared_ptr<connection> conn, clock_type::time_point stop,
+        boost::spawn::yield_context yield) {
+    try {
+        while (clock_type::now() < stop) {
+            conn->window.acquire(yield);
+            conn->sent.push_back(clock_type::now());
+            boost::asio::async_write(conn->socket, boost::asio::buffer(conn->message), yield);
+        }
+        // the server closes the connection once it has echoed everything
+        conn->socket.shutdown(tcp::socket::shutdown_send);
+    } catch (std::exception const&) {
+        conn->failed = true;
+        conn->socket.close();
+    }
+}
+
+void run_connection(std::shared_ptr<connection> conn, tcp::resolver::results_type const& endpoints,
+        clock_type::time_point stop, boost::spawn::yield_context yield) {
+    try {
+        boost::asio::async_connect(conn->socket, endpoints, yield);
+        conn->socket.set_option(tcp::no_delay(true));
+        boost::spawn_fiber(yield,
+                [conn, stop](boost::spawn::yield_context yield) {
+                    write_messages(conn, stop, yield);
+                });
+        for (;;) {
+            boost::system::error_code ec;
+            boost::asio::async_read(conn->socket, boost::asio::buffer(conn->reply), yield[ec]);
+            if (boost::asio::error::eof == ec && conn->sent.empty()) {
+                break;
+            }
+            if (ec) {
+                throw boost::system::system_error(ec);
+            }
+            conn->latencies.push_back(clock_type::now() - conn->sent.front());
+            conn->sent.pop_front();
+            conn->window.release();
+        }
+    } catch (std::exception const& e) {
+        std::cerr << "Connection failed: " << e.what() << "\n";
+        conn->failed = true;
+        conn->socket.close();
+        // unblocks the writer, whose next write fails
+        conn->window.release(conn->sent.size() + 1);
+    }
+}
+
+std::chrono::microseconds percentile(std::vector<clock_type::duration>& latencies, double p) {
+    auto nth = latencies.begin() + static_cast<std::ptrdiff_t>(p * (latencies.size() - 1));
+    std::nth_element(latencies.begin(), nth, latencies.end());
+    return std::chrono::duration_cast<std::chrono::microseconds>(*nth);
+}
+
+int load_test(tcp::resolver::results_type const& endpoints, load_options const& opts, std::size_t threads) {
+    boost::asio::io_context io_context;
+    std::vector<std::shared_ptr<connection>> connections;
+    clock_type::time_point start = clock_type::now();
+    clock_type::time_point stop = start + opts.duration;
+    for (std::size_t i = 0; i < opts.connections; ++i) {
+        connections.push_back(std::make_shared<connection>(io_context, opts));
+        boost::spawn_fiber(io_context,
+                [conn = connections.back(), &endpoints, stop](boost::spawn::yield_context yield) {
+                    run_connection(conn, endpoints, stop, yield);
+                });
+    }
+    std::vector<std::thread> pool;
+    for (std::size_t i = 1; i < threads; ++i) {
+        pool.emplace_back([&io_context]{ io_context.run(); });
+    }
+    io_context.run();
+    for (std::thread& t : pool) {
+        t.join();
+    }
+    clock_type::duration elapsed = clock_type::now() - start;
+
+    std::vector<clock_type::duration> latencies;
+    std::size_t failed = 0;
+    for (auto const& conn : connections) {
+        latencies.insert(latencies.end(), conn->latencies.begin(), conn->latencies.end());
+        failed += conn->failed ? 1 : 0;
+    }
+    if (latencies.empty()) {
+        std::cerr << "No request was answered\n";
+        return 1;
+    }
+    double seconds = std::chrono::duration<double>(elapsed).count();
+    std::cout << opts.connections << " connections, " << opts.message_size << " byte messages, pipeline "
+              << opts.pipeline << ", " << threads << " threads: "
+              << static_cast<std::uint64_t>(latencies.size() / seconds) << " requests/s, "
+              << "p50 " << percentile(latencies, 0.5).count() << " us, "
+              << "p99 " << percentile(latencies, 0.99).count() << " us, "
+              << "p999 " << percentile(latencies, 0.999).count() << " us";
+    if (0 != failed) {
+        std::cout << ", " << failed << " connections failed";
+    }
+    std::cout << "\n";
+    return 0 != failed ? 1 : 0;
+}
+
 int main(int argc, char* argv[]) {
     try {
-        if (3 != argc) {
-            std::cerr << "Usage: blocking_tcp_echo_client <host> <port>\n";
+        if (3 != argc && (6 > argc || 8 < argc)) {
+            std::cerr << "Usage: echo_client <host> <port>\n"
+                      << "       echo_client <host> <port> <connections> <message-size> <pipeline> [<seconds> [<threads>]]\n";
             return 1;
         }
 
@@ -29,6 +176,21 @@ int main(int argc, char* argv[]) {
         tcp::resolver resolver(io_context);
         tcp::resolver::results_type endpoints =
             resolver.resolve(tcp::v4(), argv[1], argv[2]);
+
+        if (3 < argc) {
+            load_options opts;
+            opts.connections = std::strtoul(argv[3], nullptr, 10);
+            opts.message_size = std::strtoul(argv[4], nullptr, 10);
+            opts.pipeline = std::strtoul(argv[5], nullptr, 10);
+            opts.duration = std::chrono::seconds(6 < argc ? std::strtoul(argv[6], nullptr, 10) : 10);
+            std::size_t threads = 7 < argc ? std::strtoul(argv[7], nullptr, 10) : 1;
+            if (0 == opts.connections || 0 == opts.message_size || 0 == opts.pipeline || 0 == threads) {
+                std::cerr << "connections, message size, pipeline and threads must not be zero\n";
+                return 1;
+            }
+            return load_test(endpoints, opts, threads);
+        }
+
         tcp::socket s(io_context);
         boost::asio::connect(s, endpoints);
         using namespace std; // For strlen.
@@ -8,11 +8,14 @@
 // file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
 //
 
+#include <chrono>
+#include <cstdlib>
 #include <iostream>
+#include <thread>
+#include <vector>
 
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/ip/tcp.hpp>
-#include <boost/asio/steady_timer.hpp>
 #include <boost/asio/write.hpp>
 #include <boost/bind/bind.hpp>
 #include <boost/shared_ptr.hpp>
@@ -26,8 +29,7 @@ class session : public boost::enable_shared_from_this<session> {
 public:
     explicit session(boost::asio::io_context& io_context) :
         strand_(boost::asio::make_strand(io_context)),
-        socket_(io_context),
-        timer_(io_context) {
+        socket_(io_context) {
     }
 
     tcp::socket& socket() {
@@ -38,39 +40,27 @@ public:
         boost::spawn_fiber(strand_,
                 boost::bind(&session::echo,
                     shared_from_this(), boost::placeholders::_1));
-        boost::spawn_fiber(strand_,
-                boost::bind(&session::timeout,
-                    shared_from_this(), boost::placeholders::_1));
     }
 
 private:
     void echo(boost::spawn::yield_context yield) {
         try {
-            char data[128];
+            // large enough for the messages of a load test (see echo_client)
+            std::vector<char> data(64 * 1024);
             for (;;) {
-                timer_.expires_after(boost::asio::chrono::seconds(10));
-                std::size_t n = socket_.async_read_some(boost::asio::buffer(data), yield);
+                // an idle client is dropped after 10 seconds
+                yield.get_cancellation_slot().assign([this]{ socket_.cancel(); });
+                std::size_t n = socket_.async_read_some(boost::asio::buffer(data),
+                        yield.with_timeout(std::chrono::seconds(10)));
                 boost::asio::async_write(socket_, boost::asio::buffer(data, n), yield);
             }
         } catch (std::exception const& e) {
             socket_.close();
-            timer_.cancel();
-        }
-    }
-
-    void timeout(boost::spawn::yield_context yield) {
-        while (socket_.is_open()) {
-            boost::system::error_code ignored_ec;
-            timer_.async_wait(yield[ignored_ec]);
-            if (timer_.expiry() <= boost::asio::steady_timer::clock_type::now()) {
-                socket_.close();
-            }
         }
     }
 
     boost::asio::strand<boost::asio::io_context::executor_type> strand_;
     tcp::socket                                                 socket_;
-    boost::asio::steady_timer                                   timer_;
 };
 
 void do_accept(boost::asio::io_context& io_context,
@@ -88,15 +78,23 @@ void do_accept(boost::asio::io_context& io_context,
 
 int main(int argc, char* argv[]) {
     try {
-        if (2 != argc) {
-            std::cerr << "Usage: echo_server <port>\n";
+        if (2 != argc && 3 != argc) {
+            std::cerr << "Usage: echo_server <port> [<threads>]\n";
             return 1;
         }
         boost::asio::io_context io_context;
         boost::spawn_fiber(io_context,
                 boost::bind(do_accept,
                     boost::ref(io_context), atoi(argv[1]), boost::placeholders::_1));
+        // each session runs in its own strand
+        std::vector<std::thread> threads;
+        for (int i = 1; i < (3 == argc ? atoi(argv[2]) : 1); ++i) {
+            threads.emplace_back([&io_context]{ io_context.run(); });
+        }
         io_context.run();
+        for (std::thread& t : threads) {
+            t.join();
+        }
     } catch (std::exception const& e) {
         std::cerr << "Exception: " << e.what() << "\n";
     }
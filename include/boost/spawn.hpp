@@ -9,24 +9,65 @@
 #ifndef BOOST_SPAWN_SPAWN_H
 #define BOOST_SPAWN_SPAWN_H
 
+#include <chrono>
 #include <memory>
+#include <utility>
 
 #include <boost/system/system_error.hpp>
 
 #include <boost/context/fixedsize_stack.hpp>
 #include <boost/context/segmented_stack.hpp>
 
+#include <boost/spawn/cancellation.hpp>
+#include <boost/spawn/concurrency_policy.hpp>
 #include <boost/spawn/detail/net.hpp>
 #include <boost/spawn/detail/is_stack_allocator.hpp>
+#include <boost/spawn/result.hpp>
 
 namespace boost {
 namespace spawn {
 namespace detail {
 
+class fiber_control;
 class spawn_context;
+class spawn_record;
+
+template< typename Handler >
+class single_threaded_handler;
 
 }
 
+template< typename Handler, typename T >
+class basic_yield_into;
+
+template< typename Handler >
+class basic_yield_result;
+
+// Refers to a spawned fiber from any thread, without keeping its stack
+// alive. Obtained with basic_yield_context::get_handle().
+class fiber_handle {
+public:
+    fiber_handle() noexcept = default;
+
+    explicit fiber_handle( std::shared_ptr< detail::fiber_control > control) noexcept :
+        control_{ std::move( control) } {
+    }
+
+    // Interrupts the operation the fiber is suspended in by emitting the
+    // fiber's cancellation signal (see basic_yield_context::get_cancellation_slot()).
+    // The signal is emitted through the fiber's executor, which must run the
+    // fiber's handlers one at a time (a strand or the single_threaded tag).
+    // Does nothing once the fiber has terminated.
+    void cancel() const;
+
+    explicit operator bool() const noexcept {
+        return nullptr != control_;
+    }
+
+private:
+    std::shared_ptr< detail::fiber_control >    control_{};
+};
+
 // Context object represents the current execution context.
 // The basic_yield_context class is used to represent the current execution
 // context. A basic_yield_context may be passed as a handler to an
@@ -39,13 +80,14 @@ public:
     // spawn_fiber() function passes a yield context as an argument to the fiber
     // function.
     basic_yield_context(
-            std::weak_ptr< detail::spawn_context > const& callee,
+            detail::spawn_record * callee,
             detail::spawn_context & caller,
             Handler & handler) :
         callee_{ callee },
         caller_{ caller },
         handler_{ handler },
-        ec_{ 0 } {
+        ec_{ 0 },
+        deadline_{ std::chrono::steady_clock::time_point::max() } {
     }
 
     // Construct a yield context from another yield context type.
@@ -56,7 +98,8 @@ public:
         callee_{ other.callee_ },
         caller_{ other.caller_ },
         handler_{ other.handler_ },
-        ec_{ other.ec_ } {
+        ec_{ other.ec_ },
+        deadline_{ other.deadline_ } {
     }
 
     // Return a yield context that sets the specified error_code.
@@ -70,20 +113,131 @@ public:
         return tmp;
     }
 
+    // Return a yield context whose asynchronous operations are cancelled
+    // once deadline has passed, e.g.
+    //   yield.get_cancellation_slot().assign( [&sock]{ sock.cancel(); });
+    //   sock.async_read_some( buffer, yield.with_timeout( std::chrono::milliseconds{ 200 }) );
+    // On expiry the fiber's cancellation signal is emitted (see
+    // get_cancellation_slot()); an operation that then fails with
+    // operation_aborted reports timed_out instead. All operations started
+    // with the returned yield context share the same deadline.
+    // The I/O object is not cancelled by the deadline itself: a plain Asio
+    // operation ends at the deadline only if a cancellation handler has been
+    // installed before it. Each completed operation clears the slot, so the
+    // handler has to be installed again before every operation.
+    basic_yield_context with_deadline( std::chrono::steady_clock::time_point deadline) const {
+        basic_yield_context tmp{ * this };
+        tmp.deadline_ = deadline;
+        return tmp;
+    }
+
+    // Like with_deadline(), with the deadline timeout from now.
+    template< typename Rep, typename Period >
+    basic_yield_context with_timeout( std::chrono::duration< Rep, Period > const& timeout) const {
+        return with_deadline( std::chrono::steady_clock::now()
+                + std::chrono::duration_cast< std::chrono::steady_clock::duration >( timeout) );
+    }
+
+    // Return a completion token that stores the result of the asynchronous
+    // operation in out instead of returning it, e.g.
+    //   std::size_t n;
+    //   boost::asio::async_read( sock, buffer, yield.into( n) );
+    // The value passed to the completion handler is assigned to out
+    // directly, without being staged in the yield context; an operation
+    // completing with several values assigns them as a std::tuple. For a
+    // result without default constructor, out may be a boost::optional.
+    // The error_code is handled as by this yield context.
+    template< typename T >
+    basic_yield_into< Handler, T > into( T & out) const {
+        return basic_yield_into< Handler, T >{ * this, out };
+    }
+
+    // Return a yield context whose asynchronous operations report failure
+    // in their return value instead of throwing, e.g.
+    //   boost::spawn::result< std::size_t > r = sock.async_read_some( buffer, yield.as_result() );
+    //   if ( ! r && boost::asio::error::eof == r.error() ) { ... }
+    // The operation returns a result< T > holding the error_code and the
+    // value, if any. An error_code bound with operator[] is not set.
+    basic_yield_result< Handler > as_result() const;
+
+    // Slot of the fiber's cancellation signal. A cancellation handler
+    // installed here is called by fiber_handle::cancel() and cleared when the
+    // next asynchronous operation on this yield context completes, e.g.
+    //   yield.get_cancellation_slot().assign( [&sock]{ sock.cancel(); });
+    //   sock.async_read_some( buffer, yield);
+    // The waits of mutex, condition_variable, semaphore and channel, and
+    // when_all() and when_any(), install their own handlers.
+    cancellation_slot get_cancellation_slot() const noexcept;
+
+    // Returns a handle by which the fiber can be cancelled from outside.
+    fiber_handle get_handle() const;
+
 //private:
-    std::weak_ptr< detail::spawn_context >  callee_;
+    detail::spawn_record *                  callee_;
     detail::spawn_context &                 caller_;
     Handler                                 handler_;
     boost::system::error_code *             ec_;
+    std::chrono::steady_clock::time_point   deadline_;
+};
+
+// Completion token returned by basic_yield_context::into().
+template< typename Handler, typename T >
+class basic_yield_into {
+public:
+    basic_yield_into( basic_yield_context< Handler > const& yield, T & out) :
+        yield_{ yield },
+        out_{ & out } {
+    }
+
+//private:
+    basic_yield_context< Handler >  yield_;
+    T                           *   out_;
 };
 
-using yield_context = basic_yield_context< detail::net::executor_binder< void(*)(), detail::net::executor > >;
+// Yield context returned by basic_yield_context::as_result(). It is a yield
+// context, and can be passed on as one; only the operations started with it
+// directly return a result.
+template< typename Handler >
+class basic_yield_result : public basic_yield_context< Handler > {
+public:
+    explicit basic_yield_result( basic_yield_context< Handler > const& yield) :
+        basic_yield_context< Handler >{ yield } {
+    }
+};
+
+template< typename Handler >
+basic_yield_result< Handler > basic_yield_context< Handler >::as_result() const {
+    return basic_yield_result< Handler >{ * this };
+}
+
+// Yield context of a fiber bound to an executor of type Executor. Unlike
+// yield_context, it does not erase the executor's type, so completion
+// handlers are dispatched without going through the polymorphic executor.
+template< typename Executor >
+using executor_yield_context = basic_yield_context< detail::net::executor_binder< void(*)(), Executor > >;
+
+// Yield context of a fiber running in a strand of Executor. This is the
+// type spawn_fiber() passes to the fiber function when it is given an
+// execution context, an executor or a strand.
+template< typename Executor >
+using strand_yield_context = executor_yield_context< detail::net::strand< Executor > >;
+
+// Yield context of a fiber spawned with the single_threaded tag on an
+// executor of type Executor; the fiber is bound to the executor directly.
+template< typename Executor >
+using single_threaded_yield_context = basic_yield_context<
+    detail::single_threaded_handler< detail::net::executor_binder< void(*)(), Executor > > >;
+
+using yield_context = executor_yield_context< detail::net::executor >;
 
 }
 
 // The spawn_fiber() function is a high-level wrapper over the Boost.Context
 // library (spawn_context). This function enables programs to
 // implement asynchronous logic in a synchronous manner.
+// The fiber's stack is obtained from the stack allocator when the fiber
+// runs for the first time, not by spawn_fiber() itself: a fiber queued
+// behind a busy executor is a small handler without a stack.
 template< typename Function, typename StackAllocator = boost::context::default_stack >
 auto spawn_fiber( Function && fn, StackAllocator && salloc = StackAllocator() )
     -> typename std::enable_if<
@@ -99,6 +253,15 @@ auto spawn_fiber( Handler && hndlr, Function && fn, StackAllocator && salloc = S
             boost::spawn::detail::is_stack_allocator< typename std::decay< StackAllocator >::type >::value
         >::type;
 
+template< typename Handler, typename Function, typename StackAllocator = boost::context::default_stack >
+auto spawn_fiber( boost::spawn::single_threaded, Handler && hndlr, Function && fn, StackAllocator && salloc = StackAllocator() )
+    -> typename std::enable_if<
+            ! boost::spawn::detail::net::is_executor< typename std::decay< Handler >::type >::value &&
+            ! std::is_convertible< Handler &, boost::spawn::detail::net::execution_context & >::value &&
+            ! boost::spawn::detail::is_stack_allocator< typename std::decay< Function >::type >::value &&
+            boost::spawn::detail::is_stack_allocator< typename std::decay< StackAllocator >::type >::value
+        >::type;
+
 template< typename Handler, typename Function, typename StackAllocator = boost::context::default_stack >
 auto spawn_fiber( boost::spawn::basic_yield_context< Handler > ctx, Function && fn, StackAllocator && salloc = StackAllocator() )
     -> typename std::enable_if<
@@ -125,6 +288,20 @@ auto spawn_fiber( ExecutionContext & ctx, Function && function, StackAllocator &
             boost::spawn::detail::is_stack_allocator< typename std::decay< StackAllocator >::type >::value
         >::type;
 
+template< typename Function, typename Executor, typename StackAllocator = boost::context::default_stack >
+auto spawn_fiber( boost::spawn::single_threaded, Executor const& ex, Function && function, StackAllocator && salloc = StackAllocator() )
+    -> typename std::enable_if<
+            boost::spawn::detail::net::is_executor< Executor >::value &&
+            boost::spawn::detail::is_stack_allocator< typename std::decay< StackAllocator >::type >::value
+        >::type;
+
+template< typename Function, typename ExecutionContext, typename StackAllocator = boost::context::default_stack >
+auto spawn_fiber( boost::spawn::single_threaded, ExecutionContext & ctx, Function && function, StackAllocator && salloc = StackAllocator() )
+    -> typename std::enable_if<
+            std::is_convertible< ExecutionContext &, boost::spawn::detail::net::execution_context & >::value &&
+            boost::spawn::detail::is_stack_allocator< typename std::decay< StackAllocator >::type >::value
+        >::type;
+
 }
 
 #include <boost/spawn/impl/spawn.hpp>
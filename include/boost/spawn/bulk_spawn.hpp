@@ -0,0 +1,293 @@
+//          Copyright Oliver Kowalke 2021.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef BOOST_SPAWN_BULK_SPAWN_H
+#define BOOST_SPAWN_BULK_SPAWN_H
+
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <boost/context/fixedsize_stack.hpp>
+
+#include <boost/spawn.hpp>
+#include <boost/spawn/concurrency_policy.hpp>
+#include <boost/spawn/detail/net.hpp>
+#include <boost/spawn/detail/is_stack_allocator.hpp>
+
+namespace boost {
+namespace spawn {
+
+// When spawn_fibers() obtains the stacks of the fibers
+enum class stack_allocation {
+    // by the calling thread, before spawn_fibers() returns
+    eager,
+    // by the handler starting the fibers, right before each fiber runs for
+    // the first time; a fiber that has not started yet holds no stack
+    deferred
+};
+
+namespace detail {
+
+// Fiber function of the fiber with the given index
+template< typename Function >
+class indexed_function {
+public:
+    indexed_function( Function const& fn, std::size_t index) :
+        fn_( fn),
+        index_{ index } {
+    }
+
+    template< typename Handler >
+    void operator()( basic_yield_context< Handler > yield) {
+        fn_( yield, index_);
+    }
+
+private:
+    Function        fn_;
+    std::size_t     index_;
+};
+
+// Each fiber runs in its own strand of the executor, as with spawn_fiber()
+template< typename Executor >
+struct strand_target {
+    using executor_type = Executor;
+    using handler_type = net::executor_binder< void(*)(), net::strand< Executor > >;
+
+    Executor    ex;
+
+    handler_type make_handler() const {
+        return net::bind_executor( net::strand< Executor >{ ex }, & default_spawn_handler);
+    }
+};
+
+// The fibers are bound to the executor itself (single_threaded)
+template< typename Executor >
+struct single_threaded_target {
+    using executor_type = Executor;
+    using handler_type = single_threaded_handler< net::executor_binder< void(*)(), Executor > >;
+
+    Executor    ex;
+
+    handler_type make_handler() const {
+        return handler_type{ net::bind_executor( ex, & default_spawn_handler) };
+    }
+};
+
+// Runs a fiber of spawn_fibers() until it suspends for the first time
+template< typename Policy >
+struct bulk_start {
+    void operator()() {
+        callee->resume();
+    }
+
+    spawn_record_ptr< Policy >  callee;
+};
+
+// Holds the fibers of spawn_fibers(), and their stacks if allocated
+// eagerly, and starts the fibers from a single handler. The frame of each
+// fiber is built on its stack right before the fiber is started, so that it
+// is still in the cache when the fiber runs until its first suspension
+// point; then the next fiber is started. If a fiber throws, the exception
+// leaves the handler like that of a fiber started by spawn_fiber(); the
+// fibers not started yet are posted again. Stacks of fibers that never
+// start are released.
+template< typename Target, typename Function, typename StackAllocator >
+class bulk_spawn_helper {
+public:
+    using handler_type = typename Target::handler_type;
+    using frame_type = spawn_frame< handler_type, Function, StackAllocator >;
+    using policy_type = typename concurrency_policy< handler_type >::type;
+
+    bulk_spawn_helper( Target const& target, std::vector< Function > && functions, StackAllocator const& salloc,
+                       stack_allocation allocation) :
+            target_( target),
+            functions_{ std::move( functions) },
+            salloc_( salloc) {
+        if ( stack_allocation::deferred == allocation) {
+            return;
+        }
+        stacks_.reserve( functions_.size() );
+        try {
+            for ( std::size_t i = 0; i < functions_.size(); ++i) {
+                stacks_.push_back( salloc_.allocate() );
+            }
+        } catch (...) {
+            release();
+            throw;
+        }
+    }
+
+    bulk_spawn_helper( bulk_spawn_helper &&) = default;
+    bulk_spawn_helper & operator=( bulk_spawn_helper &&) = delete;
+
+    ~bulk_spawn_helper() {
+        release();
+    }
+
+    void operator()() {
+#if defined(BOOST_SPAWN_ENABLE_METRICS)
+        metrics_service & service = net::use_service< metrics_service >( context_of( target_.ex, 0) );
+#endif
+        try {
+            while ( next_ < functions_.size() ) {
+                const std::size_t i = next_++;
+                boost::context::stack_context sctx = i < stacks_.size() ? stacks_[ i] : salloc_.allocate();
+                spawn_record_ptr< policy_type > callee{
+                    frame_type::create( sctx, target_.make_handler(), true,
+                            std::move( functions_[ i]), StackAllocator( salloc_) ) };
+#if defined(BOOST_SPAWN_ENABLE_METRICS)
+                static_cast< frame_type * >( callee.get() )->metrics_.attach(
+                        service, static_cast< frame_type * >( callee.get() )->stack_size() );
+#endif
+                auto ex = net::get_associated_executor(
+                        static_cast< frame_type * >( callee.get() )->handler() );
+                // runs inline, the strand of the fiber is not used yet
+                ex.dispatch( bulk_start< policy_type >{ std::move( callee) }, std::allocator< void >{} );
+            }
+        } catch (...) {
+            if ( next_ < functions_.size() ) {
+                typename Target::executor_type ex{ target_.ex };
+                ex.post( std::move( * this), std::allocator< void >{} );
+            }
+            throw;
+        }
+    }
+
+private:
+    Target                                          target_;
+    std::vector< Function >                         functions_;
+    StackAllocator                                  salloc_;
+    std::vector< boost::context::stack_context >    stacks_{};
+    std::size_t                                     next_{ 0 };
+
+    void release() noexcept {
+        for ( std::size_t i = next_; i < stacks_.size(); ++i) {
+            salloc_.deallocate( stacks_[ i]);
+        }
+        stacks_.clear();
+    }
+};
+
+template< typename Target, typename Function, typename StackAllocator >
+void start_fibers( Target const& target, std::vector< Function > && functions, StackAllocator const& salloc,
+                   stack_allocation allocation) {
+    if ( functions.empty() ) {
+        return;
+    }
+    bulk_spawn_helper< Target, Function, StackAllocator > helper{ target, std::move( functions), salloc, allocation };
+    target.ex.dispatch( std::move( helper), std::allocator< void >{} );
+}
+
+template< typename Target, typename Function, typename StackAllocator >
+void spawn_fibers_n( Target const& target, std::size_t n, Function const& function, StackAllocator const& salloc,
+                     stack_allocation allocation) {
+    std::vector< indexed_function< Function > > functions;
+    functions.reserve( n);
+    for ( std::size_t i = 0; i < n; ++i) {
+        functions.emplace_back( function, i);
+    }
+    start_fibers( target, std::move( functions), salloc, allocation);
+}
+
+template< typename Target, typename Iterator, typename StackAllocator >
+void spawn_fibers_range( Target const& target, Iterator first, Iterator last, StackAllocator const& salloc,
+                         stack_allocation allocation) {
+    using function_type = typename std::decay< decltype( * first) >::type;
+    start_fibers( target, std::vector< function_type >( first, last), salloc, allocation);
+}
+
+template< typename Executor >
+auto executor_of( Executor const& ex)
+    -> typename std::enable_if< net::is_executor< Executor >::value, Executor >::type {
+    return ex;
+}
+
+template< typename ExecutionContext >
+auto executor_of( ExecutionContext & ctx)
+    -> typename std::enable_if<
+            std::is_convertible< ExecutionContext &, net::execution_context & >::value,
+            typename ExecutionContext::executor_type
+        >::type {
+    return ctx.get_executor();
+}
+
+template< typename T >
+using executor_of_t = decltype( executor_of( std::declval< T & >() ) );
+
+}}
+
+// Spawns n fibers on an executor or execution context; fiber i runs
+// fn( yield, i). Equivalent to calling spawn_fiber() n times, except that
+// the fibers are started by a single handler, which runs each of them
+// until it first suspends. Each fiber has its own strand.
+// By default the stacks of all fibers are allocated up front by the
+// calling thread; if a stack cannot be allocated, no fiber is started and
+// the exception is rethrown. With stack_allocation::deferred, a fiber
+// obtains its stack only when it is started, as with spawn_fiber().
+template< typename ExecutorOrContext, typename Function, typename StackAllocator = boost::context::default_stack >
+auto spawn_fibers( ExecutorOrContext && ex, std::size_t n, Function const& fn, StackAllocator const& salloc = StackAllocator(),
+                   boost::spawn::stack_allocation allocation = boost::spawn::stack_allocation::eager)
+    -> typename std::enable_if<
+            ! std::is_same< typename std::decay< ExecutorOrContext >::type, boost::spawn::single_threaded >::value &&
+            boost::spawn::detail::is_stack_allocator< StackAllocator >::value,
+            decltype( void( boost::spawn::detail::executor_of( ex) ) )
+        >::type {
+    using executor_type = boost::spawn::detail::executor_of_t< typename std::remove_reference< ExecutorOrContext >::type >;
+    boost::spawn::detail::spawn_fibers_n(
+            boost::spawn::detail::strand_target< executor_type >{ boost::spawn::detail::executor_of( ex) },
+            n, fn, salloc, allocation);
+}
+
+// Spawns one fiber per element of [first, last); each element is copied
+// and called as fiber function with the yield context, as with spawn_fiber().
+template< typename ExecutorOrContext, typename Iterator, typename StackAllocator = boost::context::default_stack >
+auto spawn_fibers( ExecutorOrContext && ex, Iterator first, Iterator last, StackAllocator const& salloc = StackAllocator(),
+                   boost::spawn::stack_allocation allocation = boost::spawn::stack_allocation::eager)
+    -> typename std::enable_if<
+            ! std::is_same< typename std::decay< ExecutorOrContext >::type, boost::spawn::single_threaded >::value &&
+            boost::spawn::detail::is_stack_allocator< StackAllocator >::value,
+            decltype( void( boost::spawn::detail::executor_of( ex) ), void( * first) )
+        >::type {
+    using executor_type = boost::spawn::detail::executor_of_t< typename std::remove_reference< ExecutorOrContext >::type >;
+    boost::spawn::detail::spawn_fibers_range(
+            boost::spawn::detail::strand_target< executor_type >{ boost::spawn::detail::executor_of( ex) },
+            first, last, salloc, allocation);
+}
+
+// Like spawn_fibers(), with the fibers bound to the executor directly
+// (see spawn_fiber( single_threaded, ...) ).
+template< typename ExecutorOrContext, typename Function, typename StackAllocator = boost::context::default_stack >
+auto spawn_fibers( boost::spawn::single_threaded, ExecutorOrContext && ex, std::size_t n, Function const& fn, StackAllocator const& salloc = StackAllocator(),
+                   boost::spawn::stack_allocation allocation = boost::spawn::stack_allocation::eager)
+    -> typename std::enable_if<
+            boost::spawn::detail::is_stack_allocator< StackAllocator >::value,
+            decltype( void( boost::spawn::detail::executor_of( ex) ) )
+        >::type {
+    using executor_type = boost::spawn::detail::executor_of_t< typename std::remove_reference< ExecutorOrContext >::type >;
+    boost::spawn::detail::spawn_fibers_n(
+            boost::spawn::detail::single_threaded_target< executor_type >{ boost::spawn::detail::executor_of( ex) },
+            n, fn, salloc, allocation);
+}
+
+template< typename ExecutorOrContext, typename Iterator, typename StackAllocator = boost::context::default_stack >
+auto spawn_fibers( boost::spawn::single_threaded, ExecutorOrContext && ex, Iterator first, Iterator last, StackAllocator const& salloc = StackAllocator(),
+                   boost::spawn::stack_allocation allocation = boost::spawn::stack_allocation::eager)
+    -> typename std::enable_if<
+            boost::spawn::detail::is_stack_allocator< StackAllocator >::value,
+            decltype( void( boost::spawn::detail::executor_of( ex) ), void( * first) )
+        >::type {
+    using executor_type = boost::spawn::detail::executor_of_t< typename std::remove_reference< ExecutorOrContext >::type >;
+    boost::spawn::detail::spawn_fibers_range(
+            boost::spawn::detail::single_threaded_target< executor_type >{ boost::spawn::detail::executor_of( ex) },
+            first, last, salloc, allocation);
+}
+
+}
+
+#endif // BOOST_SPAWN_BULK_SPAWN_H
@@ -0,0 +1,142 @@
+//          Copyright Oliver Kowalke 2021.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef BOOST_SPAWN_CANCELLATION_H
+#define BOOST_SPAWN_CANCELLATION_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace boost {
+namespace spawn {
+
+class cancellation_slot;
+
+// Per-operation cancellation, modelled on the cancellation_signal and
+// cancellation_slot of later Asio versions, which this Asio lacks. The
+// party that starts an operation installs a cancellation handler in the
+// slot, typically one that cancels the I/O object, e.g.
+//
+//   token.get_cancellation_slot().assign( [&sock]{ sock.cancel(); });
+//
+// emit() calls the handler. The handler is stored in the signal itself, so
+// it must be small and nothrow move constructible; nothing is allocated.
+// Neither class is thread-safe: emit() must not run concurrently with
+// assign() or clear().
+class cancellation_signal {
+public:
+    cancellation_signal() noexcept = default;
+
+    cancellation_signal( cancellation_signal const&) = delete;
+    cancellation_signal & operator=( cancellation_signal const&) = delete;
+
+    ~cancellation_signal() {
+        clear();
+    }
+
+    // calls the installed handler, if any; the handler stays installed
+    void emit() {
+        if ( nullptr != invoke_) {
+            invoke_( & storage_);
+        }
+    }
+
+    cancellation_slot slot() noexcept;
+
+private:
+    friend class cancellation_slot;
+
+    static constexpr std::size_t storage_size = 4 * sizeof( void *);
+
+    typename std::aligned_storage< storage_size >::type     storage_;
+    void                                                 (* invoke_)( void *){ nullptr };
+    void                                                 (* destroy_)( void *){ nullptr };
+
+    void clear() noexcept {
+        if ( nullptr != destroy_) {
+            destroy_( & storage_);
+            invoke_ = nullptr;
+            destroy_ = nullptr;
+        }
+    }
+};
+
+// Where a cancellation handler for one operation is installed. A default
+// constructed slot is not connected to a signal: handlers assigned to it are
+// dropped, the operation cannot be cancelled.
+class cancellation_slot {
+public:
+    cancellation_slot() noexcept = default;
+
+    explicit cancellation_slot( cancellation_signal * sig) noexcept :
+        sig_{ sig } {
+    }
+
+    // installs fn, replacing the previous handler
+    template< typename Fn >
+    void assign( Fn && fn) {
+        using fn_type = typename std::decay< Fn >::type;
+        static_assert( sizeof( fn_type) <= cancellation_signal::storage_size,
+                "cancellation handler too large");
+        static_assert( alignof( fn_type) <= alignof( std::max_align_t),
+                "cancellation handler over-aligned");
+        if ( nullptr == sig_) {
+            return;
+        }
+        sig_->clear();
+        ::new ( static_cast< void * >( & sig_->storage_) ) fn_type( std::forward< Fn >( fn) );
+        sig_->invoke_ = [] ( void * p) {
+            ( * static_cast< fn_type * >( p) )();
+        };
+        sig_->destroy_ = [] ( void * p) {
+            static_cast< fn_type * >( p)->~fn_type();
+        };
+    }
+
+    void clear() noexcept {
+        if ( nullptr != sig_) {
+            sig_->clear();
+        }
+    }
+
+    bool is_connected() const noexcept {
+        return nullptr != sig_;
+    }
+
+    bool has_handler() const noexcept {
+        return nullptr != sig_ && nullptr != sig_->invoke_;
+    }
+
+private:
+    cancellation_signal *   sig_{ nullptr };
+};
+
+inline
+cancellation_slot cancellation_signal::slot() noexcept {
+    return cancellation_slot{ this };
+}
+
+// Cancellation slot associated with a completion handler, the counterpart of
+// associated_cancellation_slot of later Asio versions. Operations that
+// support cancellation install their handler in this slot.
+template< typename T, typename = void >
+struct associated_cancellation_slot {
+    using type = cancellation_slot;
+
+    static type get( T const&) noexcept {
+        return type{};
+    }
+};
+
+template< typename T >
+cancellation_slot get_associated_cancellation_slot( T const& t) noexcept {
+    return associated_cancellation_slot< T >::get( t);
+}
+
+}}
+
+#endif // BOOST_SPAWN_CANCELLATION_H
@@ -0,0 +1,317 @@
+//          Copyright Oliver Kowalke 2021.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef BOOST_SPAWN_CHANNEL_H
+#define BOOST_SPAWN_CHANNEL_H
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include <boost/assert.hpp>
+#include <boost/optional.hpp>
+#include <boost/system/error_code.hpp>
+
+#include <boost/spawn.hpp>
+#include <boost/spawn/detail/wait_queue.hpp>
+
+namespace boost {
+namespace spawn {
+
+enum class channel_errc {
+    closed = 1
+};
+
+class channel_category_impl : public boost::system::error_category {
+public:
+    char const* name() const noexcept override {
+        return "boost.spawn.channel";
+    }
+
+    std::string message( int ev) const override {
+        switch ( static_cast< channel_errc >( ev) ) {
+        case channel_errc::closed:
+            return "channel is closed";
+        default:
+            return "unknown channel error";
+        }
+    }
+};
+
+inline
+boost::system::error_category const& channel_category() noexcept {
+    static channel_category_impl category;
+    return category;
+}
+
+inline
+boost::system::error_code make_error_code( channel_errc e) noexcept {
+    return boost::system::error_code{ static_cast< int >( e), channel_category() };
+}
+
+}
+
+namespace system {
+
+template<>
+struct is_error_code_enum< boost::spawn::channel_errc > : public std::true_type {
+};
+
+}
+
+namespace spawn {
+
+// Bounded multi-producer/multi-consumer channel between fibers. The
+// elements are kept in a ring buffer allocated once, at construction.
+// send() suspends the calling fiber only while the buffer is full,
+// receive() only while it is empty. A fiber waiting in receive() gets the
+// element handed over directly by the sender. Waiting fibers are resumed
+// through their own executors in FIFO order, so a channel may be shared
+// by fibers on different strands and threads.
+//
+// After close(), send() fails with channel_errc::closed; receive() returns
+// the elements still buffered and then fails with channel_errc::closed.
+// A waiting send() or receive() fails with operation_aborted if the wait is
+// cancelled; a cancelled send() has not sent its value. Failures are thrown
+// as boost::system::system_error, or stored in the error_code bound to the
+// yield context (yield[ec]).
+// T must be move-constructible; receive( yield), which returns T even if
+// it fails, requires a default-constructible T as well.
+template< typename T >
+class channel {
+public:
+    using value_type = T;
+
+    explicit channel( std::size_t capacity) :
+        storage_{ new storage_type[ capacity] },
+        capacity_{ capacity } {
+        BOOST_ASSERT_MSG( 0 < capacity, "channel capacity must not be zero");
+    }
+
+    channel( channel const&) = delete;
+    channel & operator=( channel const&) = delete;
+
+    // fibers still waiting are unwound
+    ~channel() {
+        detail::destroy_all( senders_.pop_all() );
+        detail::destroy_all( receivers_.pop_all() );
+        while ( 0 < size_) {
+            pop_front();
+        }
+    }
+
+    template< typename Handler >
+    void send( T value, basic_yield_context< Handler > const& yield) {
+        detail::waiter * wake = nullptr;
+        status st;
+        {
+            std::unique_lock< detail::spinlock > lk{ splk_ };
+            st = try_push( value, wake);
+        }
+        if ( nullptr != wake) {
+            wake->complete();
+        }
+        if ( status::blocked != st) {
+            detail::complete_now( yield, status::closed == st ? make_error_code( channel_errc::closed) : boost::system::error_code{} );
+            return;
+        }
+        detail::wait( yield, [this,&value] ( detail::waiter & w, boost::system::error_code & ec) {
+            detail::waiter * wake = nullptr;
+            {
+                std::unique_lock< detail::spinlock > lk{ splk_ };
+                status st = try_push( value, wake);
+                if ( status::blocked == st) {
+                    // a receiver moves the value out of this frame
+                    w.data_ = std::addressof( value);
+                    senders_.push( w);
+                    return true;
+                }
+                if ( status::closed == st) {
+                    ec = channel_errc::closed;
+                }
+            }
+            if ( nullptr != wake) {
+                wake->complete();
+            }
+            return false;
+        },
+        [this] ( detail::waiter & w) {
+            std::unique_lock< detail::spinlock > lk{ splk_ };
+            return senders_.remove( w);
+        });
+    }
+
+    // returns a value-initialized T if the channel is closed and drained
+    // and yield has an error_code bound; the overload below does not need
+    // a default-constructible T
+    template< typename Handler >
+    T receive( basic_yield_context< Handler > const& yield) {
+        static_assert( std::is_default_constructible< T >::value,
+                       "channel< T >::receive( yield) requires a default-constructible T, "
+                       "use receive( boost::optional< T > &, yield) instead");
+        boost::optional< T > slot;
+        receive( slot, yield);
+        return slot ? std::move( * slot) : T();
+    }
+
+    // stores the element in out; out is left empty if receive fails
+    template< typename Handler >
+    void receive( boost::optional< T > & out, basic_yield_context< Handler > const& yield) {
+        out = boost::none;
+        detail::waiter * wake = nullptr;
+        status st;
+        {
+            std::unique_lock< detail::spinlock > lk{ splk_ };
+            st = try_pop( out, wake);
+        }
+        if ( nullptr != wake) {
+            wake->complete();
+        }
+        if ( status::blocked != st) {
+            detail::complete_now( yield, status::closed == st ? make_error_code( channel_errc::closed) : boost::system::error_code{} );
+        } else {
+            detail::wait( yield, [this,&out] ( detail::waiter & w, boost::system::error_code & ec) {
+                detail::waiter * wake = nullptr;
+                {
+                    std::unique_lock< detail::spinlock > lk{ splk_ };
+                    status st = try_pop( out, wake);
+                    if ( status::blocked == st) {
+                        // a sender constructs the value in out
+                        w.data_ = std::addressof( out);
+                        receivers_.push( w);
+                        return true;
+                    }
+                    if ( status::closed == st) {
+                        ec = channel_errc::closed;
+                    }
+                }
+                if ( nullptr != wake) {
+                    wake->complete();
+                }
+                return false;
+            },
+            [this] ( detail::waiter & w) {
+                std::unique_lock< detail::spinlock > lk{ splk_ };
+                return receivers_.remove( w);
+            });
+        }
+    }
+
+    // wakes all waiting fibers; see above
+    void close() {
+        detail::waiter * senders;
+        detail::waiter * receivers;
+        {
+            std::unique_lock< detail::spinlock > lk{ splk_ };
+            closed_ = true;
+            senders = senders_.pop_all();
+            receivers = receivers_.pop_all();
+        }
+        complete_waiters( senders, channel_errc::closed);
+        complete_waiters( receivers, channel_errc::closed);
+    }
+
+    bool is_closed() const noexcept {
+        std::unique_lock< detail::spinlock > lk{ splk_ };
+        return closed_;
+    }
+
+    std::size_t size() const noexcept {
+        std::unique_lock< detail::spinlock > lk{ splk_ };
+        return size_;
+    }
+
+    std::size_t capacity() const noexcept {
+        return capacity_;
+    }
+
+private:
+    using storage_type = typename std::aligned_storage< sizeof( T), alignof( T) >::type;
+
+    enum class status {
+        done,
+        closed,
+        blocked
+    };
+
+    mutable detail::spinlock            splk_{};
+    std::unique_ptr< storage_type[] >   storage_;
+    std::size_t                         capacity_;
+    std::size_t                         head_{ 0 };
+    std::size_t                         size_{ 0 };
+    bool                                closed_{ false };
+    detail::wait_queue                  senders_{};     // wait while full
+    detail::wait_queue                  receivers_{};   // wait while empty
+
+    T * slot( std::size_t i) noexcept {
+        return reinterpret_cast< T * >( std::addressof( storage_[ ( head_ + i) % capacity_]) );
+    }
+
+    void push_back( T && value) {
+        ::new ( static_cast< void * >( slot( size_) ) ) T( std::move( value) );
+        ++size_;
+    }
+
+    void pop_front() noexcept {
+        slot( 0)->~T();
+        head_ = ( head_ + 1) % capacity_;
+        --size_;
+    }
+
+    // lock held; wake is set to a receiver that must be completed
+    status try_push( T & value, detail::waiter *& wake) {
+        if ( closed_) {
+            return status::closed;
+        }
+        detail::waiter * w = receivers_.front();
+        if ( nullptr != w) {
+            // receivers wait only while the buffer is empty: hand over directly;
+            // the receiver stays queued if the move throws
+            static_cast< boost::optional< T > * >( w->data_)->emplace( std::move( value) );
+            receivers_.pop();
+            wake = w;
+            return status::done;
+        }
+        if ( size_ < capacity_) {
+            push_back( std::move( value) );
+            return status::done;
+        }
+        return status::blocked;
+    }
+
+    // lock held; wake is set to a sender that must be completed
+    status try_pop( boost::optional< T > & out, detail::waiter *& wake) {
+        if ( 0 < size_) {
+            out.emplace( std::move( * slot( 0) ) );
+            pop_front();
+            // senders wait only while the buffer is full: refill the slot
+            detail::waiter * w = senders_.front();
+            if ( nullptr != w) {
+                // the sender stays queued if the move throws
+                push_back( std::move( * static_cast< T * >( w->data_) ) );
+                senders_.pop();
+                wake = w;
+            }
+            return status::done;
+        }
+        return closed_ ? status::closed : status::blocked;
+    }
+
+    static void complete_waiters( detail::waiter * w, boost::system::error_code const& ec) {
+        while ( nullptr != w) {
+            detail::waiter * next = w->next_;
+            w->complete( ec);
+            w = next;
+        }
+    }
+};
+
+}}
+
+#endif // BOOST_SPAWN_CHANNEL_H
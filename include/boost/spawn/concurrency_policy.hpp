@@ -0,0 +1,73 @@
+//          Copyright Oliver Kowalke 2021.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef BOOST_SPAWN_CONCURRENCY_POLICY_H
+#define BOOST_SPAWN_CONCURRENCY_POLICY_H
+
+#include <atomic>
+#include <cstddef>
+
+
+namespace boost {
+namespace spawn {
+
+// A concurrency policy decides how the bookkeeping of a fiber is
+// synchronised: the reference count of its record and the counter that
+// orders "completion handler ran" against "async_result::get() reached".
+
+// Default policy: the fiber may be resumed from any thread.
+struct multi_threaded {
+    using counter_type = std::atomic< long >;
+
+    static void increment( std::atomic< std::size_t > & count) noexcept {
+        count.fetch_add( 1, std::memory_order_relaxed);
+    }
+
+    // returns the new value
+    static std::size_t decrement( std::atomic< std::size_t > & count) noexcept {
+        std::size_t n = count.fetch_sub( 1, std::memory_order_release) - 1;
+        if ( 0 == n) {
+            std::atomic_thread_fence( std::memory_order_acquire);
+        }
+        return n;
+    }
+};
+
+// All completion handlers of the fiber run on one thread at a time, with
+// the executor establishing the ordering between them. Counting uses plain
+// loads and stores instead of read-modify-write operations. Every copy and
+// destruction of the fiber's handlers must happen on that thread as well,
+// including those made while the execution context shuts down and those of
+// a yield_context converted from the fiber's yield context, which count with
+// multi_threaded on the same record.
+// An object of this type passed to spawn_fiber() selects this policy.
+struct single_threaded {
+    using counter_type = long;
+
+    static void increment( std::atomic< std::size_t > & count) noexcept {
+        count.store( count.load( std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    // returns the new value
+    static std::size_t decrement( std::atomic< std::size_t > & count) noexcept {
+        std::size_t n = count.load( std::memory_order_relaxed) - 1;
+        count.store( n, std::memory_order_relaxed);
+        return n;
+    }
+};
+
+// Selects the concurrency policy for fibers whose completion handler is of
+// type Handler. Specialize for handler types that are known to be resumed
+// from a single thread only. Handlers bound to a strand keep multi_threaded:
+// a strand orders its handlers, but not the copies and destructions of the
+// fiber's handlers made outside of it.
+template< typename Handler, typename = void >
+struct concurrency_policy {
+    using type = multi_threaded;
+};
+
+}}
+
+#endif // BOOST_SPAWN_CONCURRENCY_POLICY_H
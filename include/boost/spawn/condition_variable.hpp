@@ -0,0 +1,96 @@
+//          Copyright Oliver Kowalke 2021.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef BOOST_SPAWN_CONDITION_VARIABLE_H
+#define BOOST_SPAWN_CONDITION_VARIABLE_H
+
+#include <mutex>
+
+#include <boost/spawn.hpp>
+#include <boost/spawn/detail/wait_queue.hpp>
+#include <boost/spawn/mutex.hpp>
+
+namespace boost {
+namespace spawn {
+
+// Condition variable for spawned fibers, used together with
+// boost::spawn::mutex. wait() suspends the calling fiber instead of
+// blocking the thread.
+class condition_variable {
+public:
+    condition_variable() = default;
+
+    condition_variable( condition_variable const&) = delete;
+    condition_variable & operator=( condition_variable const&) = delete;
+
+    // fibers still waiting are unwound
+    ~condition_variable() {
+        detail::destroy_all( waiters_.pop_all() );
+    }
+
+    // mtx must be locked by the calling fiber; it is unlocked while the
+    // fiber waits and locked again before wait() returns, also if the wait
+    // fails with operation_aborted because it has been cancelled
+    template< typename Handler >
+    void wait( mutex & mtx, basic_yield_context< Handler > const& yield) {
+        boost::system::error_code ec;
+        detail::wait( yield[ ec],
+            [this,&mtx] ( detail::waiter & w, boost::system::error_code &) {
+                {
+                    std::unique_lock< detail::spinlock > lk{ splk_ };
+                    waiters_.push( w);
+                }
+                // enqueued before unlocking, so a notification sent after the
+                // mutex is acquired by the notifier cannot be lost
+                mtx.unlock();
+                return true;
+            },
+            [this] ( detail::waiter & w) {
+                std::unique_lock< detail::spinlock > lk{ splk_ };
+                return waiters_.remove( w);
+            });
+        mtx.relock( yield);
+        detail::complete_now( yield, ec);
+    }
+
+    // stops waiting if a wait fails and yield has an error_code bound
+    template< typename Handler, typename Predicate >
+    void wait( mutex & mtx, basic_yield_context< Handler > const& yield, Predicate pred) {
+        while ( ! pred() ) {
+            wait( mtx, yield);
+            if ( nullptr != yield.ec_ && * yield.ec_) {
+                return;
+            }
+        }
+    }
+
+    void notify_one() {
+        detail::waiter * w;
+        {
+            std::unique_lock< detail::spinlock > lk{ splk_ };
+            w = waiters_.pop();
+        }
+        if ( nullptr != w) {
+            w->complete();
+        }
+    }
+
+    void notify_all() {
+        detail::waiter * w;
+        {
+            std::unique_lock< detail::spinlock > lk{ splk_ };
+            w = waiters_.pop_all();
+        }
+        detail::complete_all( w);
+    }
+
+private:
+    detail::spinlock    splk_{};
+    detail::wait_queue  waiters_{};
+};
+
+}}
+
+#endif // BOOST_SPAWN_CONDITION_VARIABLE_H
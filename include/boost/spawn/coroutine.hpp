@@ -0,0 +1,142 @@
+//          Copyright Oliver Kowalke 2021.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef BOOST_SPAWN_COROUTINE_H
+#define BOOST_SPAWN_COROUTINE_H
+
+#include <boost/asio/detail/config.hpp>
+
+// the stackless backend needs C++20 coroutines
+#if defined(BOOST_ASIO_HAS_CO_AWAIT)
+
+#include <exception>
+#include <type_traits>
+#include <utility>
+
+#include <boost/asio/any_io_executor.hpp>
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/redirect_error.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <boost/system/error_code.hpp>
+
+#include <boost/spawn.hpp>
+#include <boost/spawn/detail/net.hpp>
+
+namespace boost {
+namespace spawn {
+
+// Tag selecting the stackless backend of spawn_fiber(): the function runs
+// as a C++20 coroutine instead of on a stack of its own.
+struct stackless {
+};
+
+// Completion token passed to a function spawned with the stackless tag,
+// the counterpart of basic_yield_context. An asynchronous operation started
+// with it returns an awaitable, e.g.
+//   std::size_t n = co_await sock.async_read_some( buffer, ctx);
+// A failed operation throws system_error, unless an error_code is supplied
+// with operator[].
+template< typename Executor >
+class basic_coroutine_context {
+public:
+    using executor_type = Executor;
+
+    explicit basic_coroutine_context( Executor const& ex) :
+        ex_{ ex } {
+    }
+
+    executor_type get_executor() const noexcept {
+        return ex_;
+    }
+
+    // Return a token that sets the specified error_code, like
+    // basic_yield_context::operator[].
+    boost::asio::redirect_error_t< boost::asio::use_awaitable_t< Executor > >
+    operator[]( boost::system::error_code & ec) const {
+        return { boost::asio::use_awaitable_t< Executor >{}, ec };
+    }
+
+private:
+    Executor    ex_;
+};
+
+using coroutine_context = basic_coroutine_context< boost::asio::any_io_executor >;
+
+namespace detail {
+
+// Rethrows the exception that left the coroutine from the handler that
+// completes it, so that it leaves the executor's run(), as with fibers.
+struct coroutine_completion {
+    void operator()( std::exception_ptr eptr) const {
+        if ( eptr) {
+            std::rethrow_exception( eptr);
+        }
+    }
+};
+
+template< typename Executor, typename Function >
+void spawn_coroutine( Executor const& ex, Function && function) {
+    using function_type = typename std::decay< Function >::type;
+    boost::asio::co_spawn( ex,
+            [fn = function_type( std::forward< Function >( function) ), ctx = coroutine_context{ ex }]() mutable {
+                return fn( ctx);
+            },
+            coroutine_completion{} );
+}
+
+}}
+
+template< typename Executor, typename Signature >
+class SPAWN_NET_NAMESPACE::async_result< boost::spawn::basic_coroutine_context< Executor >, Signature > :
+        public async_result< use_awaitable_t< Executor >, Signature > {
+public:
+    template< typename Initiation, typename ...InitArgs >
+    static auto initiate( Initiation && initiation, boost::spawn::basic_coroutine_context< Executor >, InitArgs && ... args) {
+        return async_result< use_awaitable_t< Executor >, Signature >::initiate(
+                std::forward< Initiation >( initiation), use_awaitable_t< Executor >{},
+                std::forward< InitArgs >( args)... );
+    }
+};
+
+// Spawns function as a stackless coroutine. function is called with a
+// coroutine_context and must return boost::asio::awaitable< void >; the
+// coroutine is given its own strand within ex.
+template< typename Function, typename Executor >
+auto spawn_fiber( boost::spawn::stackless, Executor const& ex, Function && function)
+    -> typename std::enable_if< boost::spawn::detail::net::is_executor< Executor >::value >::type {
+    boost::spawn::detail::spawn_coroutine(
+            boost::spawn::detail::net::strand< Executor >{ ex },
+            std::forward< Function >( function) );
+}
+
+template< typename Function, typename Executor >
+void spawn_fiber( boost::spawn::stackless, boost::spawn::detail::net::strand< Executor > const& ex, Function && function) {
+    boost::spawn::detail::spawn_coroutine( ex, std::forward< Function >( function) );
+}
+
+template< typename Function, typename ExecutionContext >
+auto spawn_fiber( boost::spawn::stackless, ExecutionContext & ctx, Function && function)
+    -> typename std::enable_if<
+            std::is_convertible< ExecutionContext &, boost::spawn::detail::net::execution_context & >::value
+        >::type {
+    spawn_fiber( boost::spawn::stackless{}, ctx.get_executor(), std::forward< Function >( function) );
+}
+
+// Spawns function as a stackless coroutine that runs in the executor of
+// the fiber identified by ctx, as spawn_fiber( ctx, ...) does for fibers.
+template< typename Handler, typename Function >
+void spawn_fiber( boost::spawn::stackless, boost::spawn::basic_yield_context< Handler > ctx, Function && function) {
+    boost::spawn::detail::spawn_coroutine(
+            boost::spawn::detail::net::get_associated_executor( ctx.handler_),
+            std::forward< Function >( function) );
+}
+
+}
+
+#endif // defined(BOOST_ASIO_HAS_CO_AWAIT)
+
+#endif // BOOST_SPAWN_COROUTINE_H
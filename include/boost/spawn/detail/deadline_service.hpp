@@ -0,0 +1,198 @@
+//          Copyright Oliver Kowalke 2021.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef BOOST_SPAWN_DETAIL_DEADLINE_SERVICE_H
+#define BOOST_SPAWN_DETAIL_DEADLINE_SERVICE_H
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+#include <boost/asio/basic_waitable_timer.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/execution_context.hpp>
+#include <boost/optional.hpp>
+#include <boost/system/error_code.hpp>
+
+#include <boost/spawn/detail/fiber_control.hpp>
+#include <boost/spawn/detail/net.hpp>
+
+namespace boost {
+namespace spawn {
+namespace detail {
+
+template< typename T = void >
+class basic_deadline_service;
+
+using deadline_service = basic_deadline_service<>;
+
+// Deadline of an operation a fiber is suspended in. The entry lives on the
+// fiber's stack; it is linked into the deadline_service while the operation
+// is pending.
+class deadline_entry {
+public:
+    using clock_type = std::chrono::steady_clock;
+
+    clock_type::time_point      expiry_{};
+    fiber_control           *   control_{ nullptr };
+    std::uint64_t               seq_{ 0 };
+
+private:
+    friend class basic_deadline_service<>;
+
+    deadline_entry          *   prev_{ nullptr };
+    deadline_entry          *   next_{ nullptr };
+    bool                        linked_{ false };
+};
+
+// Execution context service keeping the pending deadlines of the fibers
+// spawned on executors of that context, ordered by expiry. A single timer,
+// armed at the earliest deadline, serves all of them: registering a deadline
+// allocates nothing. Expired deadlines cancel their fibers through the
+// fibers' executors (fiber_control::expire()).
+template< typename T >
+class basic_deadline_service : public boost::asio::execution_context::service {
+public:
+    static boost::asio::execution_context::id id;
+
+    explicit basic_deadline_service( boost::asio::execution_context & ctx) :
+        boost::asio::execution_context::service{ ctx } {
+    }
+
+    // ex is the executor of the registering fiber; the timer is created
+    // on the first call
+    template< typename Executor >
+    void add( deadline_entry & e, Executor const& ex) {
+        std::unique_lock< std::mutex > lk{ mtx_ };
+        if ( stopped_) {
+            return;
+        }
+        if ( ! timer_) {
+            timer_.emplace( net::executor{ ex });
+        }
+        // deadlines of equal timeouts are added in order: search from the back
+        deadline_entry * prev = tail_;
+        while ( nullptr != prev && e.expiry_ < prev->expiry_) {
+            prev = prev->prev_;
+        }
+        e.prev_ = prev;
+        e.next_ = nullptr != prev ? prev->next_ : head_;
+        if ( nullptr != e.next_) {
+            e.next_->prev_ = & e;
+        } else {
+            tail_ = & e;
+        }
+        if ( nullptr != prev) {
+            prev->next_ = & e;
+        } else {
+            head_ = & e;
+        }
+        e.linked_ = true;
+        if ( ! armed_ || e.expiry_ < armed_expiry_) {
+            arm( e.expiry_);
+        }
+    }
+
+    // While deadlines are left, the timer stays armed; it re-arms for the
+    // next deadline when it fires. Otherwise it is cancelled, so that it
+    // does not keep the execution context running.
+    void remove( deadline_entry & e) noexcept {
+        std::unique_lock< std::mutex > lk{ mtx_ };
+        if ( ! e.linked_) {
+            return;
+        }
+        unlink( e);
+        if ( nullptr == head_ && armed_) {
+            armed_ = false;
+            boost::system::error_code ec;
+            timer_->cancel( ec);
+        }
+    }
+
+private:
+    using timer_type = boost::asio::basic_waitable_timer<
+        deadline_entry::clock_type,
+        boost::asio::wait_traits< deadline_entry::clock_type >,
+        net::executor >;
+
+    std::mutex                          mtx_{};
+    boost::optional< timer_type >       timer_{};
+    deadline_entry                  *   head_{ nullptr };
+    deadline_entry                  *   tail_{ nullptr };
+    deadline_entry::clock_type::time_point  armed_expiry_{};
+    bool                                armed_{ false };
+    // number of the last wait started by arm()
+    std::uint64_t                       armed_seq_{ 0 };
+    bool                                stopped_{ false };
+
+    void unlink( deadline_entry & e) noexcept {
+        if ( nullptr != e.prev_) {
+            e.prev_->next_ = e.next_;
+        } else {
+            head_ = e.next_;
+        }
+        if ( nullptr != e.next_) {
+            e.next_->prev_ = e.prev_;
+        } else {
+            tail_ = e.prev_;
+        }
+        e.prev_ = e.next_ = nullptr;
+        e.linked_ = false;
+    }
+
+    // mtx_ held
+    void arm( deadline_entry::clock_type::time_point expiry) {
+        armed_ = true;
+        armed_expiry_ = expiry;
+        const std::uint64_t seq = ++armed_seq_;
+        // cancels a pending wait: its handler sees operation_aborted, unless
+        // it has completed already
+        timer_->expires_at( expiry);
+        timer_->async_wait( [this,seq] ( boost::system::error_code const& ec) {
+            if ( boost::asio::error::operation_aborted != ec) {
+                expired( seq);
+            }
+        });
+    }
+
+    void expired( std::uint64_t seq) {
+        std::unique_lock< std::mutex > lk{ mtx_ };
+        if ( seq != armed_seq_) {
+            // a stale wait, completed before arm() started a new one
+            return;
+        }
+        armed_ = false;
+        if ( stopped_) {
+            return;
+        }
+        const deadline_entry::clock_type::time_point now = deadline_entry::clock_type::now();
+        while ( nullptr != head_ && head_->expiry_ <= now) {
+            deadline_entry & e = * head_;
+            unlink( e);
+            // e is left to its fiber once unlocked
+            e.control_->expire( e.seq_);
+        }
+        if ( nullptr != head_) {
+            arm( head_->expiry_);
+        }
+    }
+
+    void shutdown() override {
+        std::unique_lock< std::mutex > lk{ mtx_ };
+        stopped_ = true;
+        while ( nullptr != head_) {
+            unlink( * head_);
+        }
+        // before the timer's own service is destroyed
+        timer_.reset();
+    }
+};
+
+template< typename T >
+boost::asio::execution_context::id basic_deadline_service< T >::id;
+
+}}}
+
+#endif // BOOST_SPAWN_DETAIL_DEADLINE_SERVICE_H
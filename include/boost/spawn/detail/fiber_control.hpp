@@ -0,0 +1,41 @@
+//          Copyright Oliver Kowalke 2021.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef BOOST_SPAWN_DETAIL_FIBER_CONTROL_H
+#define BOOST_SPAWN_DETAIL_FIBER_CONTROL_H
+
+#include <cstdint>
+#include <memory>
+
+namespace boost {
+namespace spawn {
+namespace detail {
+
+class spawn_record;
+
+// Shared by the fiber_handles of a fiber and by the deadlines it has
+// registered. record_ is reset when the fiber's record is destroyed; it is
+// accessed through the fiber's executor only.
+class fiber_control : public std::enable_shared_from_this< fiber_control > {
+public:
+    explicit fiber_control( spawn_record * record) noexcept :
+        record_{ record } {
+    }
+
+    virtual ~fiber_control() = default;
+
+    // emits the cancellation signal of the fiber through its executor
+    virtual void cancel() = 0;
+
+    // like cancel(), but only if the fiber is still suspended in the
+    // operation whose deadline has number seq
+    virtual void expire( std::uint64_t seq) = 0;
+
+    spawn_record    *   record_;
+};
+
+}}}
+
+#endif // BOOST_SPAWN_DETAIL_FIBER_CONTROL_H
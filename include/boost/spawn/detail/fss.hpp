@@ -0,0 +1,96 @@
+//          Copyright Oliver Kowalke 2021.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef BOOST_SPAWN_DETAIL_FSS_H
+#define BOOST_SPAWN_DETAIL_FSS_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+#include <boost/config.hpp>
+
+namespace boost {
+namespace spawn {
+namespace detail {
+
+class spawn_record;
+
+// Fiber running on the calling thread, if any. Not inlined, so that the
+// address of the thread-local variable is not cached across a suspension:
+// the fiber may be resumed on another thread.
+BOOST_NOINLINE inline
+spawn_record *& current_record_slot() noexcept {
+    static thread_local spawn_record * current = nullptr;
+    return current;
+}
+
+BOOST_NOINLINE inline
+spawn_record * current_record() noexcept {
+    return current_record_slot();
+}
+
+// index of a new fiber-specific slot; indices are never reused
+inline
+std::size_t fss_register() noexcept {
+    static std::atomic< std::size_t > next{ 0 };
+    return next.fetch_add( 1, std::memory_order_relaxed);
+}
+
+// Fiber-specific values of one fiber, indexed by slot. The vector is
+// allocated when the fiber stores its first value.
+class fss_slots {
+public:
+    using cleanup_function = void(*)();
+    using invoke_function = void(*)( cleanup_function, void *);
+
+    fss_slots() = default;
+
+    fss_slots( fss_slots const&) = delete;
+    fss_slots & operator=( fss_slots const&) = delete;
+
+    void * get( std::size_t index) const noexcept {
+        return index < slots_.size() ? slots_[ index].value : nullptr;
+    }
+
+    void set( std::size_t index, void * value, invoke_function invoke, cleanup_function fn) {
+        if ( slots_.size() <= index) {
+            slots_.resize( index + 1);
+        }
+        slots_[ index] = slot{ value, invoke, fn };
+    }
+
+    // runs the cleanup functions; a cleanup function may store new values,
+    // so repeat until every slot is empty
+    void cleanup() noexcept {
+        bool found = true;
+        while ( found) {
+            found = false;
+            for ( std::size_t i = 0; i < slots_.size(); ++i) {
+                slot s = slots_[ i];
+                if ( nullptr != s.value) {
+                    found = true;
+                    slots_[ i] = slot{};
+                    if ( nullptr != s.fn) {
+                        s.invoke( s.fn, s.value);
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    struct slot {
+        void                *   value{ nullptr };
+        invoke_function         invoke{ nullptr };
+        cleanup_function        fn{ nullptr };
+    };
+
+    std::vector< slot >     slots_{};
+};
+
+}}}
+
+#endif // BOOST_SPAWN_DETAIL_FSS_H
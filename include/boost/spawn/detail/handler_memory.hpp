@@ -0,0 +1,127 @@
+//          Copyright Oliver Kowalke 2021.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef BOOST_SPAWN_DETAIL_HANDLER_MEMORY_H
+#define BOOST_SPAWN_DETAIL_HANDLER_MEMORY_H
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+
+namespace boost {
+namespace spawn {
+namespace detail {
+
+// Recycles the memory of the operations a fiber starts: one block is kept
+// per size class, so that the state of the next operation of the same kind
+// (and of the strand's wrapper of its completion handler) reuses the block
+// of the previous one. Blocks are released to a slot from the thread that
+// completes the operation, which need not be the fiber's thread; taking and
+// returning a block is a single atomic exchange.
+// Every block is obtained from the global operator new, so that a block may
+// be returned with the global operator delete as well (see
+// handler_allocator).
+class handler_memory {
+public:
+    handler_memory() = default;
+
+    handler_memory( handler_memory const&) = delete;
+    handler_memory & operator=( handler_memory const&) = delete;
+
+    ~handler_memory() {
+        for ( std::atomic< void * > & block : blocks_) {
+            ::operator delete( block.load( std::memory_order_acquire) );
+        }
+    }
+
+    void * allocate( std::size_t size) {
+        const std::size_t i = size_class( size);
+        if ( classes != i && nullptr != blocks_[ i].load( std::memory_order_relaxed) ) {
+            if ( void * p = blocks_[ i].exchange( nullptr, std::memory_order_acquire) ) {
+                return p;
+            }
+        }
+        return new_block( size);
+    }
+
+    void deallocate( void * p, std::size_t size) noexcept {
+        const std::size_t i = size_class( size);
+        void * expected = nullptr;
+        if ( classes != i &&
+             blocks_[ i].compare_exchange_strong( expected, p, std::memory_order_release, std::memory_order_relaxed) ) {
+            return;
+        }
+        ::operator delete( p);
+    }
+
+    // a block of the size class of size, not recycled
+    static void * new_block( std::size_t size) {
+        const std::size_t i = size_class( size);
+        return ::operator new( classes != i ? min_block << i : size);
+    }
+
+private:
+    static constexpr std::size_t    min_block = 64;
+    static constexpr std::size_t    classes = 5; // up to 1024 bytes
+
+    std::atomic< void * >   blocks_[ classes]{};
+
+    static std::size_t size_class( std::size_t size) noexcept {
+        std::size_t i = 0;
+        for ( std::size_t n = min_block; n < size && i < classes; n <<= 1) {
+            ++i;
+        }
+        return i;
+    }
+};
+
+// Allocator associated with the completion handlers of a fiber. Without a
+// handler_memory (a handler that no longer refers to its fiber) blocks are
+// neither taken from nor returned to a cache.
+template< typename T >
+class handler_allocator {
+public:
+    using value_type = T;
+
+    explicit handler_allocator( handler_memory * memory) noexcept :
+        memory_{ memory } {
+    }
+
+    template< typename U >
+    handler_allocator( handler_allocator< U > const& other) noexcept :
+        memory_{ other.memory_ } {
+    }
+
+    T * allocate( std::size_t n) {
+        static_assert( alignof( T) <= alignof( std::max_align_t), "over-aligned types are not supported");
+        const std::size_t size = n * sizeof( T);
+        return static_cast< T * >( nullptr != memory_ ? memory_->allocate( size) : handler_memory::new_block( size) );
+    }
+
+    void deallocate( T * p, std::size_t n) noexcept {
+        if ( nullptr != memory_) {
+            memory_->deallocate( p, n * sizeof( T) );
+        } else {
+            ::operator delete( p);
+        }
+    }
+
+    template< typename U >
+    bool operator==( handler_allocator< U > const& other) const noexcept {
+        return memory_ == other.memory_;
+    }
+
+    template< typename U >
+    bool operator!=( handler_allocator< U > const& other) const noexcept {
+        return memory_ != other.memory_;
+    }
+
+//private:
+    handler_memory  *   memory_;
+};
+
+}}}
+
+#endif // BOOST_SPAWN_DETAIL_HANDLER_MEMORY_H
@@ -11,8 +11,12 @@
 #include <boost/asio/associated_executor.hpp>
 #include <boost/asio/async_result.hpp>
 #include <boost/asio/bind_executor.hpp>
+#include <boost/asio/execution/context.hpp>
+#include <boost/asio/execution_context.hpp>
 #include <boost/asio/executor.hpp>
 #include <boost/asio/is_executor.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/query.hpp>
 #include <boost/asio/strand.hpp>
 
 #define SPAWN_NET_NAMESPACE boost::asio
@@ -25,16 +29,35 @@ namespace net {
 using boost::asio::associated_executor_t;
 using boost::asio::get_associated_executor;
 
+using boost::asio::associated_allocator;
 using boost::asio::associated_allocator_t;
 using boost::asio::get_associated_allocator;
 
 using boost::asio::execution_context;
+using boost::asio::has_service;
+using boost::asio::use_service;
 using boost::asio::executor;
 using boost::asio::executor_binder;
+using boost::asio::bind_executor;
 using boost::asio::is_executor;
+using boost::asio::post;
 
 using boost::asio::strand;
 
-}}}}
+}
+
+// execution context an executor belongs to; call with 0 to prefer the
+// executor's context() member over the execution::context property
+template< typename Executor >
+auto context_of( Executor const& ex, int) -> decltype( static_cast< boost::asio::execution_context & >( ex.context() ) ) {
+    return ex.context();
+}
+
+template< typename Executor >
+boost::asio::execution_context & context_of( Executor const& ex, long) {
+    return boost::asio::query( ex, boost::asio::execution::context);
+}
+
+}}}
 
 #endif // BOOST_SPAWN_DETAIL_NET_H
@@ -0,0 +1,209 @@
+//          Copyright Oliver Kowalke 2021.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef BOOST_SPAWN_DETAIL_OPERATION_GROUP_H
+#define BOOST_SPAWN_DETAIL_OPERATION_GROUP_H
+
+#include <cstddef>
+#include <exception>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include <boost/optional.hpp>
+
+#include <boost/spawn.hpp>
+#include <boost/spawn/cancellation.hpp>
+#include <boost/spawn/detail/net.hpp>
+#include <boost/spawn/detail/operation_result.hpp>
+
+// Machinery shared by when_all() and when_any(): one fiber starts several
+// operations, each with its own completion token, and suspends once. The
+// Group decides when the fiber is resumed:
+//
+//   bool complete( std::size_t index)    - operation index has completed;
+//                                          true if the fiber must be resumed
+//   bool initiated( std::size_t started, bool failed)
+//                                        - the first started operations are
+//                                          running; true if the fiber must
+//                                          suspend
+//   cancellation_slot slot( std::size_t index)
+//                                        - slot of operation index
+//   void cancel()                        - the fiber has been cancelled
+
+namespace boost {
+namespace spawn {
+namespace detail {
+
+// Completion token passed to the functions of a group. Like
+// basic_yield_context it refers to the fiber without holding a reference;
+// the completion handler created from it does.
+template< typename Handler, typename Group, typename Result >
+class operation_token {
+public:
+    operation_token(
+            basic_yield_context< Handler > const& yield,
+            Group & group,
+            std::size_t index,
+            boost::optional< Result > & slot) noexcept :
+        callee_{ yield.callee_ },
+        handler_{ & yield.handler_ },
+        group_{ & group },
+        index_{ index },
+        slot_{ & slot } {
+    }
+
+    cancellation_slot get_cancellation_slot() const noexcept {
+        return group_->slot( index_);
+    }
+
+//private:
+    spawn_record                *   callee_;
+    Handler const               *   handler_;
+    Group                       *   group_;
+    std::size_t                     index_;
+    boost::optional< Result >   *   slot_;
+};
+
+// stores the result of one operation and reports the completion to the group
+template< typename Handler, typename Group, typename Signature >
+class operation_handler {
+public:
+    using policy_type = typename concurrency_policy< Handler >::type;
+    using result_type = typename operation_result< Signature >::type;
+
+    explicit operation_handler( operation_token< Handler, Group, result_type > const& token) :
+        callee_{ token.callee_ },
+        handler_{ token.handler_ },
+        group_{ token.group_ },
+        index_{ token.index_ },
+        slot_{ token.slot_ } {
+    }
+
+    template< typename ...Ts >
+    void operator()( Ts && ... values) {
+        slot_->emplace( operation_result< Signature >::make( std::forward< Ts >( values)... ) );
+        if ( group_->complete( index_) ) {
+            callee_->resume();
+        }
+    }
+
+//private:
+    spawn_record_ptr< policy_type >         callee_;
+    Handler const                       *   handler_;
+    Group                               *   group_;
+    std::size_t                             index_;
+    boost::optional< result_type >      *   slot_;
+};
+
+// Starts the operations in order and suspends the fiber until the group
+// resumes it. If a function throws, the operations already started refer to
+// this frame: they are waited for before the exception is propagated.
+template< typename Handler, typename Group, typename ...Results, typename ...Functions, std::size_t ...Is >
+void run_group( basic_yield_context< Handler > const& yield,
+                Group & group,
+                std::tuple< boost::optional< Results >... > & slots,
+                std::index_sequence< Is... >,
+                Functions && ... functions) {
+    std::size_t started = 0;
+    std::exception_ptr eptr;
+    try {
+        // braced initialization starts the operations in order
+        int order[] = { 0, ( static_cast< void >( functions(
+                    operation_token< Handler, Group, Results >{ yield, group, Is, std::get< Is >( slots) } ) ),
+                ++started, 0)... };
+        static_cast< void >( order);
+    } catch (...) {
+        eptr = std::current_exception();
+    }
+    if ( group.initiated( started, nullptr != eptr) ) {
+        // cancelling the fiber cancels the operations
+        yield.get_cancellation_slot().assign( [&group] {
+            group.cancel();
+        });
+#if defined(BOOST_SPAWN_ENABLE_METRICS)
+        yield.callee_->metrics_.on_suspend();
+#endif
+        yield.caller_.resume(); // suspend caller
+    }
+    yield.get_cancellation_slot().clear();
+    if ( eptr) {
+        std::rethrow_exception( eptr);
+    }
+}
+
+// signals of the operations of a group
+template< std::size_t N >
+class group_signals {
+public:
+    cancellation_slot slot( std::size_t index) noexcept {
+        return signals_[ index].slot();
+    }
+
+    // emits the signal of each operation except skip
+    void emit( std::size_t skip = N) noexcept {
+        for ( std::size_t i = 0; i < N; ++i) {
+            if ( skip != i) {
+                signals_[ i].emit();
+            }
+        }
+    }
+
+private:
+    cancellation_signal signals_[ N];
+};
+
+// result type of a group of Functions
+template< typename ...Functions >
+using group_result = std::tuple< typename operation_result< signature_of< Functions > >::type... >;
+
+}
+
+template< typename Handler, typename Group, typename Signature >
+struct associated_cancellation_slot< detail::operation_handler< Handler, Group, Signature > > {
+    using type = cancellation_slot;
+
+    static type get( detail::operation_handler< Handler, Group, Signature > const& h) noexcept {
+        return h.group_->slot( h.index_);
+    }
+};
+
+}}
+
+template< typename Handler, typename Group, typename Result, typename ReturnType, typename ...Args >
+class SPAWN_NET_NAMESPACE::async_result< boost::spawn::detail::operation_token< Handler, Group, Result >, ReturnType( Args...) > {
+public:
+    using completion_handler_type = boost::spawn::detail::operation_handler< Handler, Group, ReturnType( Args...) >;
+    using return_type = void;
+
+    static_assert( std::is_same< Result, typename completion_handler_type::result_type >::value,
+            "the operation must complete with the signature found for it");
+
+    explicit async_result( completion_handler_type &) noexcept {
+    }
+
+    void get() noexcept {
+    }
+};
+
+template< typename Handler, typename Group, typename Signature, typename Allocator >
+struct SPAWN_NET_NAMESPACE::associated_allocator< boost::spawn::detail::operation_handler< Handler, Group, Signature >, Allocator > {
+    using type = associated_allocator_t< Handler, Allocator >;
+
+    static type get( boost::spawn::detail::operation_handler< Handler, Group, Signature > const& h, Allocator const& a = Allocator{} ) noexcept {
+        return associated_allocator< Handler, Allocator >::get( * h.handler_, a);
+    }
+};
+
+template< typename Handler, typename Group, typename Signature, typename Executor >
+struct SPAWN_NET_NAMESPACE::associated_executor< boost::spawn::detail::operation_handler< Handler, Group, Signature >, Executor > {
+    using type = associated_executor_t< Handler, Executor >;
+
+    static type get( boost::spawn::detail::operation_handler< Handler, Group, Signature > const& h, Executor const& ex = Executor{} ) noexcept {
+        return associated_executor< Handler, Executor >::get( * h.handler_, ex);
+    }
+};
+
+#endif // BOOST_SPAWN_DETAIL_OPERATION_GROUP_H
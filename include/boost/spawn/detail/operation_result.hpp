@@ -0,0 +1,108 @@
+//          Copyright Oliver Kowalke 2021.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef BOOST_SPAWN_DETAIL_OPERATION_RESULT_H
+#define BOOST_SPAWN_DETAIL_OPERATION_RESULT_H
+
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include <boost/system/error_code.hpp>
+
+#include <boost/spawn/cancellation.hpp>
+#include <boost/spawn/detail/net.hpp>
+
+namespace boost {
+namespace spawn {
+namespace detail {
+
+// Result of an asynchronous operation with completion signature Signature:
+// the error_code, success if the signature has none, followed by the other
+// arguments of the completion handler.
+template< typename Signature >
+struct operation_result;
+
+template< typename R, typename ...Args >
+struct operation_result< R( Args...) > {
+    using type = std::tuple< boost::system::error_code, typename std::decay< Args >::type... >;
+
+    template< typename ...Ts >
+    static type make( Ts && ... values) {
+        return type{ boost::system::error_code{}, std::forward< Ts >( values)... };
+    }
+};
+
+template< typename R, typename ...Args >
+struct operation_result< R( boost::system::error_code, Args...) > {
+    using type = std::tuple< boost::system::error_code, typename std::decay< Args >::type... >;
+
+    template< typename ...Ts >
+    static type make( Ts && ... values) {
+        return type{ std::forward< Ts >( values)... };
+    }
+};
+
+// Completion token used to find the completion signature of the operation
+// that fn( token) starts, without starting it: the initiating function
+// returns a signature_tag instead.
+struct signature_probe {
+    cancellation_slot get_cancellation_slot() const noexcept {
+        return cancellation_slot{};
+    }
+};
+
+template< typename Signature >
+struct signature_tag {
+};
+
+template< typename T >
+struct probed_signature {
+    static_assert( ! std::is_same< T, T >::value,
+            "the function must return the result of the asynchronous operation it starts");
+};
+
+template< typename Signature >
+struct probed_signature< signature_tag< Signature > > {
+    using type = Signature;
+};
+
+// completion signature of the operation started by a Function
+template< typename Function >
+using signature_of = typename probed_signature<
+    decltype( std::declval< Function & >()( signature_probe{} ) ) >::type;
+
+// never called
+struct signature_probe_handler {
+    explicit signature_probe_handler( signature_probe) noexcept {
+    }
+
+    template< typename ...Ts >
+    void operator()( Ts && ...) {
+    }
+};
+
+}}}
+
+template< typename ReturnType, typename ...Args >
+class SPAWN_NET_NAMESPACE::async_result< boost::spawn::detail::signature_probe, ReturnType( Args...) > {
+public:
+    using completion_handler_type = boost::spawn::detail::signature_probe_handler;
+    using return_type = boost::spawn::detail::signature_tag< ReturnType( Args...) >;
+
+    explicit async_result( completion_handler_type &) noexcept {
+    }
+
+    return_type get() noexcept {
+        return return_type{};
+    }
+
+    template< typename Initiation, typename ...InitArgs >
+    static return_type initiate( Initiation &&, boost::spawn::detail::signature_probe, InitArgs && ...) noexcept {
+        return return_type{};
+    }
+};
+
+#endif // BOOST_SPAWN_DETAIL_OPERATION_RESULT_H
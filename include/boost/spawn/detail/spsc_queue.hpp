@@ -0,0 +1,84 @@
+//          Copyright Oliver Kowalke 2021.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef BOOST_SPAWN_DETAIL_SPSC_QUEUE_H
+#define BOOST_SPAWN_DETAIL_SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+#include <boost/assert.hpp>
+
+namespace boost {
+namespace spawn {
+namespace detail {
+
+// Bounded lock-free queue of pointers between one producer thread and one
+// consumer thread. Each side keeps a private copy of the other side's
+// index and reloads it only when the queue looks full or empty, so the
+// shared cache lines move between the cores once per batch rather than
+// once per element.
+template< typename T >
+class spsc_queue {
+public:
+    explicit spsc_queue( std::size_t capacity) :
+        slots_{ new T *[ capacity + 1] },
+        size_{ capacity + 1 } {
+        BOOST_ASSERT_MSG( 0 < capacity, "queue capacity must not be zero");
+    }
+
+    spsc_queue( spsc_queue const&) = delete;
+    spsc_queue & operator=( spsc_queue const&) = delete;
+
+    // producer; false if the queue is full
+    bool push( T * t) noexcept {
+        const std::size_t tail = tail_.load( std::memory_order_relaxed);
+        const std::size_t next = tail + 1 == size_ ? 0 : tail + 1;
+        if ( next == head_cache_) {
+            head_cache_ = head_.load( std::memory_order_acquire);
+            if ( next == head_cache_) {
+                return false;
+            }
+        }
+        slots_[ tail] = t;
+        tail_.store( next, std::memory_order_release);
+        return true;
+    }
+
+    // consumer; nullptr if the queue is empty
+    T * pop() noexcept {
+        const std::size_t head = head_.load( std::memory_order_relaxed);
+        if ( head == tail_cache_) {
+            tail_cache_ = tail_.load( std::memory_order_acquire);
+            if ( head == tail_cache_) {
+                return nullptr;
+            }
+        }
+        T * t = slots_[ head];
+        head_.store( head + 1 == size_ ? 0 : head + 1, std::memory_order_release);
+        return t;
+    }
+
+private:
+    // padding keeps the two sides on separate cache lines
+    static constexpr std::size_t cache_line = 64;
+
+    std::unique_ptr< T *[] >        slots_;
+    const std::size_t               size_;
+    char                            pad0_[ cache_line];
+    // consumer side
+    std::atomic< std::size_t >      head_{ 0 };
+    std::size_t                     tail_cache_{ 0 };
+    char                            pad1_[ cache_line];
+    // producer side
+    std::atomic< std::size_t >      tail_{ 0 };
+    std::size_t                     head_cache_{ 0 };
+    char                            pad2_[ cache_line];
+};
+
+}}}
+
+#endif // BOOST_SPAWN_DETAIL_SPSC_QUEUE_H
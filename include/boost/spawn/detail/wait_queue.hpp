@@ -0,0 +1,252 @@
+//          Copyright Oliver Kowalke 2021.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef BOOST_SPAWN_DETAIL_WAIT_QUEUE_H
+#define BOOST_SPAWN_DETAIL_WAIT_QUEUE_H
+
+#include <atomic>
+#include <thread>
+#include <utility>
+
+#include <boost/asio/detail/bind_handler.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/system/error_code.hpp>
+#include <boost/system/system_error.hpp>
+
+#include <boost/spawn.hpp>
+#include <boost/spawn/cancellation.hpp>
+
+namespace boost {
+namespace spawn {
+namespace detail {
+
+// Guards the state of the synchronisation primitives. Held only for a few
+// instructions, never across a suspension; no system call unless the lock
+// is contended for longer than a few spins.
+class spinlock {
+public:
+    void lock() noexcept {
+        for ( unsigned int i = 0; state_.exchange( true, std::memory_order_acquire); ++i) {
+            while ( state_.load( std::memory_order_relaxed) ) {
+                if ( 16 < ++i) {
+                    std::this_thread::yield();
+                }
+            }
+        }
+    }
+
+    void unlock() noexcept {
+        state_.store( false, std::memory_order_release);
+    }
+
+private:
+    std::atomic< bool >     state_{ false };
+};
+
+// A fiber waiting in a wait_queue. The waiter lives on the stack of the
+// suspended fiber and owns the fiber's completion handler.
+class waiter {
+public:
+    waiter  *   next_{ nullptr };
+    void    *   data_{ nullptr };   // for use by the owner of the queue
+
+    // resumes the fiber through its executor; a failure is reported to
+    // the fiber like the failure of an asynchronous operation
+    virtual void complete( boost::system::error_code const& ec) = 0;
+
+    void complete() {
+        complete( boost::system::error_code{} );
+    }
+
+    // drops the handler without resuming the fiber
+    virtual void destroy() noexcept = 0;
+
+protected:
+    ~waiter() = default;
+};
+
+template< typename Handler >
+class waiter_op final : public waiter {
+public:
+    explicit waiter_op( Handler && handler) :
+        handler_{ std::move( handler) } {
+    }
+
+    void complete( boost::system::error_code const& ec) override {
+        // never resume inline: the fiber might belong to another strand
+        boost::asio::post( boost::asio::detail::bind_handler( std::move( handler_), ec) );
+    }
+
+    void destroy() noexcept override {
+        Handler h{ std::move( handler_) };
+    }
+
+    // completes on the waiting fiber itself, before it suspends
+    void complete_inline( boost::system::error_code const& ec) {
+        handler_( ec);
+    }
+
+    Handler const& handler() const noexcept {
+        return handler_;
+    }
+
+private:
+    Handler     handler_;
+};
+
+// FIFO of waiting fibers, protected by the owner's spinlock
+class wait_queue {
+public:
+    wait_queue() = default;
+
+    wait_queue( wait_queue const&) = delete;
+    wait_queue & operator=( wait_queue const&) = delete;
+
+    bool empty() const noexcept {
+        return nullptr == head_;
+    }
+
+    void push( waiter & w) noexcept {
+        w.next_ = nullptr;
+        if ( nullptr == tail_) {
+            head_ = tail_ = & w;
+        } else {
+            tail_->next_ = & w;
+            tail_ = & w;
+        }
+    }
+
+    // the waiter pop() would take, left queued
+    waiter * front() const noexcept {
+        return head_;
+    }
+
+    waiter * pop() noexcept {
+        waiter * w = head_;
+        if ( nullptr != w) {
+            head_ = w->next_;
+            if ( nullptr == head_) {
+                tail_ = nullptr;
+            }
+            w->next_ = nullptr;
+        }
+        return w;
+    }
+
+    // takes w out of the queue; false if w is not queued
+    bool remove( waiter & w) noexcept {
+        waiter * prev = nullptr;
+        for ( waiter * p = head_; nullptr != p; prev = p, p = p->next_) {
+            if ( & w == p) {
+                if ( nullptr == prev) {
+                    head_ = p->next_;
+                } else {
+                    prev->next_ = p->next_;
+                }
+                if ( tail_ == p) {
+                    tail_ = prev;
+                }
+                p->next_ = nullptr;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // takes all waiters, preserving their order
+    waiter * pop_all() noexcept {
+        waiter * w = head_;
+        head_ = tail_ = nullptr;
+        return w;
+    }
+
+private:
+    waiter  *   head_{ nullptr };
+    waiter  *   tail_{ nullptr };
+};
+
+// Suspends the fiber of yield unless enqueue( waiter &, error_code &)
+// returns false, meaning the operation finished without waiting; it failed
+// if enqueue has set the error_code. If enqueue returns true it must have
+// pushed the waiter, under the owner's lock. A failure is thrown as
+// system_error or stored in the error_code bound to yield.
+template< typename Handler, typename Enqueue >
+void wait( basic_yield_context< Handler > yield, Enqueue && enqueue) {
+    using token_type = basic_yield_context< Handler >;
+    using signature_type = void( boost::system::error_code);
+    boost::asio::async_completion< token_type, signature_type > init{ yield };
+    using handler_type = typename boost::asio::async_completion< token_type, signature_type >::completion_handler_type;
+    waiter_op< handler_type > op{ std::move( init.completion_handler) };
+    boost::system::error_code ec;
+    if ( ! enqueue( static_cast< waiter & >( op), ec) ) {
+        op.complete_inline( ec);
+    }
+    init.result.get();
+}
+
+// Like wait(), but the wait can be cancelled through the cancellation slot
+// associated with the completion handler. remove( waiter &) takes the waiter
+// out of the queue, under the owner's lock; it returns false if the waiter
+// has been dequeued already, then the wait completes normally. Otherwise the
+// wait fails with operation_aborted.
+template< typename Handler, typename Enqueue, typename Remove >
+void wait( basic_yield_context< Handler > yield, Enqueue && enqueue, Remove && remove) {
+    using token_type = basic_yield_context< Handler >;
+    using signature_type = void( boost::system::error_code);
+    boost::asio::async_completion< token_type, signature_type > init{ yield };
+    using handler_type = typename boost::asio::async_completion< token_type, signature_type >::completion_handler_type;
+    waiter_op< handler_type > op{ std::move( init.completion_handler) };
+    // once enqueued, the handler may be moved out of op by another thread
+    auto slot = get_associated_cancellation_slot( op.handler() );
+    boost::system::error_code ec;
+    if ( ! enqueue( static_cast< waiter & >( op), ec) ) {
+        op.complete_inline( ec);
+    } else {
+        slot.assign( [&op,&remove] {
+            if ( remove( static_cast< waiter & >( op) ) ) {
+                op.complete( boost::asio::error::operation_aborted);
+            }
+        });
+    }
+    init.result.get();
+}
+
+// reports the result of an operation that finished without waiting, the
+// way wait() would have
+template< typename Handler >
+void complete_now( basic_yield_context< Handler > const& yield, boost::system::error_code const& ec) {
+    // like a completed wait, drop a cancellation handler installed for it
+    yield.get_cancellation_slot().clear();
+    if ( nullptr != yield.ec_) {
+        * yield.ec_ = ec;
+    } else if ( ec) {
+        throw boost::system::system_error{ ec };
+    }
+}
+
+// resumes each waiter in the list returned by wait_queue::pop_all()
+inline
+void complete_all( waiter * w) {
+    while ( nullptr != w) {
+        waiter * next = w->next_;
+        w->complete();
+        w = next;
+    }
+}
+
+// drops the handlers of all waiters; used by destructors of the primitives
+inline
+void destroy_all( waiter * w) noexcept {
+    while ( nullptr != w) {
+        waiter * next = w->next_;
+        w->destroy();
+        w = next;
+    }
+}
+
+}}}
+
+#endif // BOOST_SPAWN_DETAIL_WAIT_QUEUE_H
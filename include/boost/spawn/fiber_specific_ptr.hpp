@@ -0,0 +1,95 @@
+//          Copyright Oliver Kowalke 2021.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef BOOST_SPAWN_FIBER_SPECIFIC_PTR_H
+#define BOOST_SPAWN_FIBER_SPECIFIC_PTR_H
+
+#include <cstddef>
+
+#include <boost/assert.hpp>
+
+#include <boost/spawn.hpp>
+#include <boost/spawn/detail/fss.hpp>
+
+namespace boost {
+namespace spawn {
+
+// Pointer with a separate value for each spawned fiber, the counterpart of
+// boost::thread_specific_ptr. The value follows the fiber when it is resumed
+// on another thread. When the fiber function is left, by return, exception
+// or forced_unwind, the cleanup function is called for the fiber's value.
+// Each fiber_specific_ptr owns a slot index fixed at construction, so
+// access is constant time. Outside of a fiber, get() returns nullptr.
+template< typename T >
+class fiber_specific_ptr {
+public:
+    using element_type = T;
+    using cleanup_function = void(*)( T *);
+
+    fiber_specific_ptr() noexcept :
+        fiber_specific_ptr{ & default_cleanup } {
+    }
+
+    // cleanup may be nullptr: values are not cleaned up
+    explicit fiber_specific_ptr( cleanup_function cleanup) noexcept :
+        index_{ detail::fss_register() },
+        cleanup_{ cleanup } {
+    }
+
+    fiber_specific_ptr( fiber_specific_ptr const&) = delete;
+    fiber_specific_ptr & operator=( fiber_specific_ptr const&) = delete;
+
+    T * get() const noexcept {
+        detail::spawn_record * r = detail::current_record();
+        return nullptr != r ? static_cast< T * >( r->fss_.get( index_) ) : nullptr;
+    }
+
+    T * operator->() const noexcept {
+        return get();
+    }
+
+    T & operator*() const noexcept {
+        return * get();
+    }
+
+    // relinquishes ownership of the fiber's value without cleaning it up
+    T * release() {
+        detail::spawn_record * r = detail::current_record();
+        BOOST_ASSERT_MSG( nullptr != r, "fiber_specific_ptr used outside of a fiber");
+        T * p = static_cast< T * >( r->fss_.get( index_) );
+        r->fss_.set( index_, nullptr, nullptr, nullptr);
+        return p;
+    }
+
+    // replaces the fiber's value, cleaning up the previous one
+    void reset( T * p = nullptr) {
+        detail::spawn_record * r = detail::current_record();
+        BOOST_ASSERT_MSG( nullptr != r, "fiber_specific_ptr used outside of a fiber");
+        T * old = static_cast< T * >( r->fss_.get( index_) );
+        if ( old == p) {
+            return;
+        }
+        r->fss_.set( index_, p, & invoke, reinterpret_cast< detail::fss_slots::cleanup_function >( cleanup_) );
+        if ( nullptr != old && nullptr != cleanup_) {
+            cleanup_( old);
+        }
+    }
+
+private:
+    std::size_t         index_;
+    cleanup_function    cleanup_;
+
+    static void default_cleanup( T * p) {
+        delete p;
+    }
+
+    static void invoke( detail::fss_slots::cleanup_function fn, void * p) {
+        reinterpret_cast< cleanup_function >( fn)( static_cast< T * >( p) );
+    }
+};
+
+}}
+
+#endif // BOOST_SPAWN_FIBER_SPECIFIC_PTR_H
@@ -10,15 +10,30 @@
 #define BOOST_SPAWN_IMPL_SPAWN_H
 
 #include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <memory>
+#include <new>
 #include <tuple>
+#include <type_traits>
+#include <utility>
 
 #include <boost/context/fiber.hpp>
+#include <boost/context/preallocated.hpp>
+#include <boost/context/stack_context.hpp>
 #include <boost/optional.hpp>
 #include <boost/system/system_error.hpp>
 
+#include <boost/spawn/concurrency_policy.hpp>
+#include <boost/spawn/detail/deadline_service.hpp>
+#include <boost/spawn/detail/fiber_control.hpp>
+#include <boost/spawn/detail/fss.hpp>
+#include <boost/spawn/detail/handler_memory.hpp>
 #include <boost/spawn/detail/net.hpp>
 #include <boost/spawn/detail/is_stack_allocator.hpp>
+#include <boost/spawn/metrics.hpp>
+#include <boost/spawn/result.hpp>
+#include <boost/spawn/stack_usage.hpp>
 
 namespace boost {
 namespace spawn {
@@ -47,16 +62,173 @@ public:
     }
 };
 
+// Execution context of a spawned fiber. The record lives at the top of the
+// fiber's own stack and is reference counted by the completion handlers that
+// may resume the fiber. If the last reference is dropped while the fiber is
+// suspended, nobody can resume it any more: the fiber is unwound and its
+// stack is released.
+class spawn_record : public spawn_context {
+public:
+    spawn_record() = default;
+
+    spawn_record( spawn_record const&) = delete;
+    spawn_record & operator=( spawn_record const&) = delete;
+
+    template< typename Policy >
+    void add_ref() noexcept {
+        Policy::increment( use_count_);
+    }
+
+    template< typename Policy >
+    void release() noexcept {
+        if ( 0 == Policy::decrement( use_count_) ) {
+            destroy();
+        }
+    }
+
+    void resume() {
+        // the resumer continues on this thread once the fiber has suspended,
+        // so the slot of this thread is the one to restore
+        spawn_record *& current = current_record_slot();
+        spawn_record * prev = std::exchange( current, this);
+#if defined(BOOST_SPAWN_ENABLE_METRICS)
+        metrics_.on_resume();
+#endif
+        ctx_ = std::move( ctx_).resume();
+        current = prev;
+#if defined(BOOST_SPAWN_ENABLE_METRICS)
+        metrics_.on_return( nullptr != eptr_);
+#endif
+        if ( eptr_) {
+            std::rethrow_exception( std::move( eptr_) );
+        }
+    }
+
+    fss_slots                   fss_{};
+    // emitted by fiber_handle::cancel()
+    cancellation_signal         cancellation_{};
+    // created by the first get_handle() or with_deadline() operation
+    std::shared_ptr< fiber_control >    control_{};
+    // deadline of the operation the fiber is suspended in (deadline_scope)
+    deadline_service            *   deadlines_{ nullptr };
+    std::uint64_t               deadline_seq_{ 0 };
+    bool                        deadline_pending_{ false };
+    bool                        deadline_expired_{ false };
+    // state of the operations started by the fiber (handler_allocator)
+    handler_memory              memory_{};
+#if defined(BOOST_SPAWN_ENABLE_METRICS)
+    fiber_counters              metrics_{};
+#endif
+
+protected:
+    virtual ~spawn_record() = default;
+
+    // destroys the record and releases the stack it lives on
+    virtual void deallocate() noexcept = 0;
+
+private:
+    std::atomic< std::size_t >  use_count_{ 0 };
+
+    void destroy() noexcept {
+        // guard against references taken and dropped while unwinding
+        use_count_.store( 1, std::memory_order_relaxed);
+        spawn_record *& current = current_record_slot();
+        spawn_record * prev = std::exchange( current, this);
+        {
+            // unwinds the fiber if it is still suspended
+            boost::context::fiber_context c = std::move( ctx_);
+        }
+        current = prev;
+        if ( control_) {
+            control_->record_ = nullptr;
+            control_.reset();
+        }
+        deallocate();
+    }
+};
+
+// Counted reference to a spawn_record. Policy selects how the count is
+// synchronised (see concurrency_policy).
+template< typename Policy >
+class spawn_record_ptr {
+public:
+    spawn_record_ptr() noexcept = default;
+
+    explicit spawn_record_ptr( spawn_record * r) noexcept :
+        r_{ r } {
+        if ( r_) {
+            r_->add_ref< Policy >();
+        }
+    }
+
+    spawn_record_ptr( spawn_record_ptr const& other) noexcept :
+        spawn_record_ptr{ other.r_ } {
+    }
+
+    spawn_record_ptr( spawn_record_ptr && other) noexcept :
+        r_{ other.r_ } {
+        other.r_ = nullptr;
+    }
+
+    ~spawn_record_ptr() {
+        reset();
+    }
+
+    spawn_record_ptr & operator=( spawn_record_ptr other) noexcept {
+        std::swap( r_, other.r_);
+        return * this;
+    }
+
+    void reset() noexcept {
+        if ( r_) {
+            std::exchange( r_, nullptr)->release< Policy >();
+        }
+    }
+
+    spawn_record * get() const noexcept {
+        return r_;
+    }
+
+    spawn_record * operator->() const noexcept {
+        return r_;
+    }
+
+private:
+    spawn_record    *   r_{ nullptr };
+};
+
+// Completion handler of a fiber spawned with the single_threaded tag. Wraps
+// the user's handler so that the fiber selects the single_threaded policy;
+// deriving keeps basic_yield_context< Handler > convertible to the yield
+// context of the wrapped handler type.
+template< typename Handler >
+class single_threaded_handler : public Handler {
+public:
+    static_assert( std::is_class< Handler >::value, "the single_threaded tag requires a handler of class type");
+
+    template< typename Hand >
+    explicit single_threaded_handler( Hand && handler) :
+        Handler{ std::forward< Hand >( handler) } {
+    }
+};
+
+// Completion handler created from a basic_yield_context. It refers to the
+// yield context's handler instead of copying it: the yield context lives on
+// the fiber's stack until the operation has completed, and the fiber's stack
+// is kept alive by callee_.
 template< typename Handler, typename ...Ts >
 class fiber_handler {
 public:
-    fiber_handler( basic_yield_context< Handler > ctx) :
-        callee_{ ctx.callee_.lock() },
+    using policy_type = typename concurrency_policy< Handler >::type;
+
+    fiber_handler( basic_yield_context< Handler > const& ctx) :
+        callee_{ ctx.callee_ },
         caller_{ ctx.caller_ },
-        handler_{ ctx.handler_ },
+        handler_{ & ctx.handler_ },
         ready_{ 0 },
         ec_{ ctx.ec_ },
-        value_{ 0 } {
+        value_{ 0 },
+        deadline_{ ctx.deadline_ } {
     }
 
     void operator()( Ts... values) {
@@ -76,24 +248,28 @@ public:
     }
 
 //private:
-    std::shared_ptr< spawn_context >            callee_;
+    spawn_record_ptr< policy_type >             callee_;
     spawn_context    &                          caller_;
-    Handler                                     handler_;
-    std::atomic< long > *                       ready_;
+    Handler const*                              handler_;
+    typename policy_type::counter_type *        ready_;
     boost::system::error_code *                 ec_;
     boost::optional< std::tuple< Ts... > > *    value_;
+    std::chrono::steady_clock::time_point       deadline_;
 };
 
 template< typename Handler, typename T >
 class fiber_handler< Handler, T > {
 public:
-    fiber_handler( basic_yield_context< Handler > ctx) :
-        callee_{ ctx.callee_.lock() },
+    using policy_type = typename concurrency_policy< Handler >::type;
+
+    fiber_handler( basic_yield_context< Handler > const& ctx) :
+        callee_{ ctx.callee_ },
         caller_{ ctx.caller_ },
-        handler_{ ctx.handler_ },
+        handler_{ & ctx.handler_ },
         ready_{ 0 },
         ec_{ ctx.ec_ },
-        value_{ 0 } {
+        value_{ 0 },
+        deadline_{ ctx.deadline_ } {
     }
 
     void operator()( T value) {
@@ -113,23 +289,27 @@ public:
     }
 
 //private:
-    std::shared_ptr< spawn_context >    callee_;
-    spawn_context    &                  caller_;
-    Handler                             handler_;
-    std::atomic< long > *               ready_;
+    spawn_record_ptr< policy_type >         callee_;
+    spawn_context    &                      caller_;
+    Handler const*                      handler_;
+    typename policy_type::counter_type *    ready_;
     boost::system::error_code *         ec_;
     boost::optional< T > *              value_;
+    std::chrono::steady_clock::time_point   deadline_;
 };
 
 template< typename Handler >
 class fiber_handler< Handler, void > {
 public:
-    fiber_handler( basic_yield_context< Handler > ctx) :
-        callee_{ ctx.callee_.lock() },
+    using policy_type = typename concurrency_policy< Handler >::type;
+
+    fiber_handler( basic_yield_context< Handler > const& ctx) :
+        callee_{ ctx.callee_ },
         caller_{ ctx.caller_ },
-        handler_{ ctx.handler_ },
+        handler_{ & ctx.handler_ },
         ready_{ 0 },
-        ec_{ ctx.ec_ } {
+        ec_{ ctx.ec_ },
+        deadline_{ ctx.deadline_ } {
     }
 
     void operator()() {
@@ -147,13 +327,64 @@ public:
     }
 
 //private:
-    std::shared_ptr< spawn_context >    callee_;
-    spawn_context    &                  caller_;
-    Handler                             handler_;
-    std::atomic< long > *               ready_;
+    spawn_record_ptr< policy_type >         callee_;
+    spawn_context    &                      caller_;
+    Handler const*                      handler_;
+    typename policy_type::counter_type *    ready_;
     boost::system::error_code *         ec_;
+    std::chrono::steady_clock::time_point   deadline_;
 };
 
+// Completion handler created from a basic_yield_into. The values passed by
+// the operation are forwarded into the caller's object, so that they are
+// moved once instead of through the optional of fiber_async_result.
+template< typename Handler, typename T, bool HasErrorCode >
+class fiber_into_handler : public fiber_handler< Handler, void > {
+public:
+    fiber_into_handler( basic_yield_into< Handler, T > const& token) :
+        fiber_handler< Handler, void >{ token.yield_ },
+        out_{ token.out_ } {
+    }
+
+    template< typename ...Args >
+    void operator()( Args && ... args) {
+        static_assert( sizeof...( Args) > ( HasErrorCode ? 1 : 0),
+                "into() requires an operation completing with a value");
+        complete( std::integral_constant< bool, HasErrorCode >{}, std::forward< Args >( args)... );
+        if ( --*this->ready_ == 0) {
+            this->callee_->resume();
+        }
+    }
+
+//private:
+    T   *   out_;
+
+    template< typename ...Args >
+    void complete( std::true_type, boost::system::error_code ec, Args && ... values) {
+        *this->ec_ = ec;
+        assign( std::forward< Args >( values)... );
+    }
+
+    template< typename ...Args >
+    void complete( std::false_type, Args && ... values) {
+        *this->ec_ = boost::system::error_code{};
+        assign( std::forward< Args >( values)... );
+    }
+
+    template< typename Arg >
+    void assign( Arg && value) {
+        *out_ = std::forward< Arg >( value);
+    }
+
+    template< typename ...Args >
+    void assign( Args && ... values) {
+        *out_ = std::forward_as_tuple( std::forward< Args >( values)... );
+    }
+};
+
+template< typename Handler >
+class deadline_scope;
+
 template< typename Handler, typename ...Ts >
 class fiber_async_result {
 public:
@@ -164,6 +395,7 @@ public:
             handler_{ h },
             caller_{ h.caller_ },
             ready_{ 2 } {
+        callee_ = h.callee_.get();
         h.ready_ = & ready_;
         out_ec_ = h.ec_;
         if ( ! out_ec_) {
@@ -173,11 +405,18 @@ public:
     }
 
     return_type get() {
-        // Must not hold shared_ptr while suspended.
+        // Must not hold a reference while suspended.
         handler_.callee_.reset();
+        deadline_scope< Handler > deadline{ callee_, * handler_.handler_, handler_.deadline_ };
         if ( --ready_ != 0) {
+#if defined(BOOST_SPAWN_ENABLE_METRICS)
+            callee_->metrics_.on_suspend();
+#endif
             caller_.resume(); // suspend caller
         }
+        // the operation has completed: its cancellation handler is stale
+        callee_->cancellation_.slot().clear();
+        deadline.finish( out_ec_ ? * out_ec_ : ec_);
         if ( ! out_ec_ && ec_) {
             throw boost::system::system_error( ec_);
         }
@@ -185,9 +424,10 @@ public:
     }
 
 private:
-    completion_handler_type &       handler_;
-    spawn_context    &               caller_;
-    std::atomic< long >             ready_;
+    completion_handler_type &                               handler_;
+    spawn_context    &                                      caller_;
+    typename completion_handler_type::policy_type::counter_type ready_;
+    spawn_record                                        *   callee_;
     boost::system::error_code *     out_ec_;
     boost::system::error_code       ec_;
     boost::optional< return_type >  value_;
@@ -203,6 +443,7 @@ public:
             handler_{ h },
             caller_{ h.caller_ },
             ready_{ 2 } {
+        callee_ = h.callee_.get();
         h.ready_ = & ready_;
         out_ec_ = h.ec_;
         if ( ! out_ec_) {
@@ -212,11 +453,18 @@ public:
     }
 
     return_type get() {
-        // Must not hold shared_ptr while suspended.
+        // Must not hold a reference while suspended.
         handler_.callee_.reset();
+        deadline_scope< Handler > deadline{ callee_, * handler_.handler_, handler_.deadline_ };
         if ( --ready_ != 0) {
+#if defined(BOOST_SPAWN_ENABLE_METRICS)
+            callee_->metrics_.on_suspend();
+#endif
             caller_.resume(); // suspend caller
         }
+        // the operation has completed: its cancellation handler is stale
+        callee_->cancellation_.slot().clear();
+        deadline.finish( out_ec_ ? * out_ec_ : ec_);
         if ( ! out_ec_ && ec_) {
             throw boost::system::system_error( ec_);
         }
@@ -224,9 +472,10 @@ public:
     }
 
 private:
-    completion_handler_type &       handler_;
-    spawn_context    &              caller_;
-    std::atomic< long >             ready_;
+    completion_handler_type &                               handler_;
+    spawn_context    &                                      caller_;
+    typename completion_handler_type::policy_type::counter_type ready_;
+    spawn_record                                        *   callee_;
     boost::system::error_code *     out_ec_;
     boost::system::error_code       ec_;
     boost::optional< return_type >  value_;
@@ -242,6 +491,7 @@ public:
             handler_{ h },
             caller_{ h.caller_ },
             ready_{ 2 } {
+        callee_ = h.callee_.get();
         h.ready_ = & ready_;
         out_ec_ = h.ec_;
         if ( ! out_ec_) {
@@ -250,24 +500,115 @@ public:
     }
 
     void get() {
-        // Must not hold shared_ptr while suspended.
+        // Must not hold a reference while suspended.
         handler_.callee_.reset();
+        deadline_scope< Handler > deadline{ callee_, * handler_.handler_, handler_.deadline_ };
         if ( --ready_ != 0) {
+#if defined(BOOST_SPAWN_ENABLE_METRICS)
+            callee_->metrics_.on_suspend();
+#endif
             caller_.resume(); // suspend caller
         }
+        // the operation has completed: its cancellation handler is stale
+        callee_->cancellation_.slot().clear();
+        deadline.finish( out_ec_ ? * out_ec_ : ec_);
         if ( ! out_ec_ && ec_) {
             throw boost::system::system_error( ec_);
         }
     }
 
 private:
-    completion_handler_type &   handler_;
-    spawn_context    &          caller_;
-    std::atomic< long >         ready_;
+    completion_handler_type &                               handler_;
+    spawn_context    &                                      caller_;
+    typename completion_handler_type::policy_type::counter_type ready_;
+    spawn_record                                        *   callee_;
     boost::system::error_code * out_ec_;
     boost::system::error_code   ec_;
 };
 
+// Suspends the fiber like fiber_async_result< Handler, void >; the result
+// has already been stored by the handler.
+template< typename Handler, typename T, bool HasErrorCode >
+class fiber_into_async_result : public fiber_async_result< Handler, void > {
+public:
+    using completion_handler_type = fiber_into_handler< Handler, T, HasErrorCode >;
+    using return_type = void;
+
+    explicit fiber_into_async_result( completion_handler_type & h) :
+        fiber_async_result< Handler, void >{ h } {
+    }
+};
+
+// Allocator associated with the completion handler of an operation started
+// by a fiber: the allocator of the fiber's handler if it has one, the
+// fiber's handler_memory otherwise.
+template< typename Handler, typename Allocator >
+struct fiber_associated_allocator {
+    using inner_type = net::associated_allocator_t< Handler, Allocator >;
+    using type = typename std::conditional<
+        std::is_same< inner_type, std::allocator< void > >::value,
+        handler_allocator< void >,
+        inner_type
+    >::type;
+
+    template< typename FiberHandler >
+    static type get( FiberHandler const& h, Allocator const& a = Allocator{} ) noexcept {
+        return get( h, a, std::is_same< type, inner_type >{} );
+    }
+
+private:
+    template< typename FiberHandler >
+    static type get( FiberHandler const& h, Allocator const& a, std::true_type) noexcept {
+        return net::associated_allocator< Handler, Allocator >::get( * h.handler_, a);
+    }
+
+    template< typename FiberHandler >
+    static type get( FiberHandler const& h, Allocator const&, std::false_type) noexcept {
+        return type{ nullptr != h.callee_.get() ? & h.callee_->memory_ : nullptr };
+    }
+};
+
+// Error code of fiber_result_async_result; a base class, so that it exists
+// before fiber_async_result is constructed.
+struct result_error {
+    boost::system::error_code   result_ec_{};
+};
+
+// Like fiber_async_result, except that get() returns the error_code with
+// the value instead of throwing.
+template< typename Handler, typename ...Ts >
+class fiber_result_async_result : private result_error, public fiber_async_result< Handler, Ts... > {
+public:
+    using base_type = fiber_async_result< Handler, Ts... >;
+    using completion_handler_type = typename base_type::completion_handler_type;
+    using return_type = result< typename base_type::return_type >;
+
+    explicit fiber_result_async_result( completion_handler_type & h) :
+        base_type{ redirect( h, result_ec_) } {
+    }
+
+    return_type get() {
+        return get( std::is_void< typename base_type::return_type >{} );
+    }
+
+private:
+    static completion_handler_type & redirect( completion_handler_type & h, boost::system::error_code & ec) noexcept {
+        h.ec_ = & ec;
+        return h;
+    }
+
+    return_type get( std::true_type) {
+        base_type::get();
+        return return_type{ result_ec_ };
+    }
+
+    return_type get( std::false_type) {
+        // the error_code is set once the fiber has been resumed
+        typename base_type::return_type value{ base_type::get() };
+        return return_type{ result_ec_, std::move( value) };
+    }
+};
+
 }}
 
 template< typename Handler, typename ReturnType >
@@ -310,83 +651,402 @@ public:
     }
 };
 
-template< typename Handler, typename Allocator, typename ...Ts >
-struct SPAWN_NET_NAMESPACE::associated_allocator< boost::spawn::detail::fiber_handler< Handler, Ts... >, Allocator > {
-    using type = associated_allocator_t< Handler, Allocator >;
+template< typename Handler, typename ReturnType >
+class SPAWN_NET_NAMESPACE::async_result< boost::spawn::basic_yield_result< Handler >, ReturnType() > :
+    public boost::spawn::detail::fiber_result_async_result< Handler, void > {
+public:
+    explicit async_result(
+            typename boost::spawn::detail::fiber_result_async_result< Handler, void >::completion_handler_type & h) :
+        boost::spawn::detail::fiber_result_async_result< Handler, void >{ h } {
+    }
+};
+
+template< typename Handler, typename ReturnType, typename ...Args >
+class SPAWN_NET_NAMESPACE::async_result< boost::spawn::basic_yield_result< Handler >, ReturnType( Args...) > :
+    public boost::spawn::detail::fiber_result_async_result< Handler, typename std::decay< Args >::type... > {
+public:
+    explicit async_result(
+            typename boost::spawn::detail::fiber_result_async_result< Handler, typename std::decay< Args >::type... >::completion_handler_type & h) :
+        boost::spawn::detail::fiber_result_async_result< Handler, typename std::decay< Args >::type... >{ h } {
+    }
+};
+
+template< typename Handler, typename ReturnType >
+class SPAWN_NET_NAMESPACE::async_result< boost::spawn::basic_yield_result< Handler >, ReturnType( boost::system::error_code) > :
+    public boost::spawn::detail::fiber_result_async_result< Handler, void > {
+public:
+    explicit async_result(
+            typename boost::spawn::detail::fiber_result_async_result< Handler, void >::completion_handler_type & h) :
+        boost::spawn::detail::fiber_result_async_result< Handler, void >{ h } {
+    }
+};
 
-    static type get( boost::spawn::detail::fiber_handler< Handler, Ts... > const& h, Allocator const& a = Allocator{} ) noexcept {
-        return associated_allocator< Handler, Allocator >::get( h.handler_, a);
+template< typename Handler, typename ReturnType, typename ...Args >
+class SPAWN_NET_NAMESPACE::async_result< boost::spawn::basic_yield_result< Handler >, ReturnType( boost::system::error_code, Args...) > :
+    public boost::spawn::detail::fiber_result_async_result< Handler, typename std::decay< Args >::type... > {
+public:
+    explicit async_result(
+            typename boost::spawn::detail::fiber_result_async_result< Handler, typename std::decay< Args >::type... >::completion_handler_type & h) :
+        boost::spawn::detail::fiber_result_async_result< Handler, typename std::decay< Args >::type... >{ h } {
+    }
+};
+
+template< typename Handler, typename T, typename ReturnType, typename ...Args >
+class SPAWN_NET_NAMESPACE::async_result< boost::spawn::basic_yield_into< Handler, T >, ReturnType( Args...) > :
+    public boost::spawn::detail::fiber_into_async_result< Handler, T, false > {
+public:
+    explicit async_result(
+            typename boost::spawn::detail::fiber_into_async_result< Handler, T, false >::completion_handler_type & h) :
+        boost::spawn::detail::fiber_into_async_result< Handler, T, false >{ h } {
+    }
+};
+
+template< typename Handler, typename T, typename ReturnType, typename ...Args >
+class SPAWN_NET_NAMESPACE::async_result< boost::spawn::basic_yield_into< Handler, T >, ReturnType( boost::system::error_code, Args...) > :
+    public boost::spawn::detail::fiber_into_async_result< Handler, T, true > {
+public:
+    explicit async_result(
+            typename boost::spawn::detail::fiber_into_async_result< Handler, T, true >::completion_handler_type & h) :
+        boost::spawn::detail::fiber_into_async_result< Handler, T, true >{ h } {
     }
 };
 
+template< typename Handler, typename Allocator, typename ...Ts >
+struct SPAWN_NET_NAMESPACE::associated_allocator< boost::spawn::detail::fiber_handler< Handler, Ts... >, Allocator > :
+    public boost::spawn::detail::fiber_associated_allocator< Handler, Allocator > {
+};
+
 template< typename Handler, typename Executor, typename ...Ts >
 struct SPAWN_NET_NAMESPACE::associated_executor< boost::spawn::detail::fiber_handler< Handler, Ts... >, Executor> {
     using type = associated_executor_t< Handler, Executor >;
 
     static type get( boost::spawn::detail::fiber_handler< Handler, Ts... > const& h, Executor const& ex = Executor{} ) noexcept {
-        return associated_executor< Handler, Executor >::get( h.handler_, ex);
+        return associated_executor< Handler, Executor >::get( * h.handler_, ex);
+    }
+};
+
+template< typename Handler, typename T, bool HasErrorCode, typename Allocator >
+struct SPAWN_NET_NAMESPACE::associated_allocator< boost::spawn::detail::fiber_into_handler< Handler, T, HasErrorCode >, Allocator > :
+    public boost::spawn::detail::fiber_associated_allocator< Handler, Allocator > {
+};
+
+template< typename Handler, typename T, bool HasErrorCode, typename Executor >
+struct SPAWN_NET_NAMESPACE::associated_executor< boost::spawn::detail::fiber_into_handler< Handler, T, HasErrorCode >, Executor > {
+    using type = associated_executor_t< Handler, Executor >;
+
+    static type get( boost::spawn::detail::fiber_into_handler< Handler, T, HasErrorCode > const& h, Executor const& ex = Executor{} ) noexcept {
+        return associated_executor< Handler, Executor >::get( * h.handler_, ex);
+    }
+};
+
+template< typename Handler, typename Allocator >
+struct SPAWN_NET_NAMESPACE::associated_allocator< boost::spawn::detail::single_threaded_handler< Handler >, Allocator > {
+    using type = associated_allocator_t< Handler, Allocator >;
+
+    static type get( boost::spawn::detail::single_threaded_handler< Handler > const& h, Allocator const& a = Allocator{} ) noexcept {
+        return associated_allocator< Handler, Allocator >::get( h, a);
+    }
+};
+
+template< typename Handler, typename Executor >
+struct SPAWN_NET_NAMESPACE::associated_executor< boost::spawn::detail::single_threaded_handler< Handler >, Executor > {
+    using type = associated_executor_t< Handler, Executor >;
+
+    static type get( boost::spawn::detail::single_threaded_handler< Handler > const& h, Executor const& ex = Executor{} ) noexcept {
+        return associated_executor< Handler, Executor >::get( h, ex);
     }
 };
 
 namespace spawn {
+
+template< typename Handler >
+struct concurrency_policy< detail::single_threaded_handler< Handler > > {
+    using type = single_threaded;
+};
+
+template< typename Handler, typename ...Ts >
+struct associated_cancellation_slot< detail::fiber_handler< Handler, Ts... > > {
+    using type = cancellation_slot;
+
+    static type get( detail::fiber_handler< Handler, Ts... > const& h) noexcept {
+        return nullptr != h.callee_.get() ? h.callee_->cancellation_.slot() : cancellation_slot{};
+    }
+};
+
+template< typename Handler, typename T, bool HasErrorCode >
+struct associated_cancellation_slot< detail::fiber_into_handler< Handler, T, HasErrorCode > > :
+    public associated_cancellation_slot< detail::fiber_handler< Handler, void > > {
+};
+
+template< typename Handler >
+cancellation_slot basic_yield_context< Handler >::get_cancellation_slot() const noexcept {
+    return callee_->cancellation_.slot();
+}
+
 namespace detail {
 
-template< typename Handler, typename Function, typename StackAllocator >
-struct spawn_data {
-    template< typename Hand, typename Func, typename Stack >
-    spawn_data( Hand && handler, bool call_handler, Func && function, Stack && salloc) :
-        handler_{ std::forward< Hand >( handler) },
-        call_handler_{ call_handler },
-        function_{ std::forward< Func >( function) },
-        salloc_{ std::forward< Stack >( salloc) } {
+template< typename Executor >
+class basic_fiber_control final : public fiber_control {
+public:
+    basic_fiber_control( spawn_record * record, Executor const& ex) :
+        fiber_control{ record },
+        ex_{ ex } {
     }
 
-    spawn_data( spawn_data const&) = delete;
-    spawn_data & operator=( spawn_data const&) = delete;
+    void cancel() override {
+        std::shared_ptr< fiber_control > self{ shared_from_this() };
+        net::post( ex_, [self] {
+            // the fiber is suspended, or has terminated
+            if ( nullptr != self->record_) {
+                self->record_->cancellation_.emit();
+            }
+        });
+    }
 
-    Handler         handler_;
-    bool            call_handler_;
-    Function        function_;
-    StackAllocator  salloc_;
-    spawn_context   caller_;
+    void expire( std::uint64_t seq) override {
+        std::shared_ptr< fiber_control > self{ shared_from_this() };
+        net::post( ex_, [self,seq] {
+            spawn_record * r = self->record_;
+            // the operation may have completed in the meantime
+            if ( nullptr != r && r->deadline_pending_ && seq == r->deadline_seq_) {
+                r->deadline_expired_ = true;
+                r->cancellation_.emit();
+            }
+        });
+    }
+
+private:
+    Executor    ex_;
 };
 
+template< typename Handler >
+fiber_control & control_of( spawn_record * record, Handler const& handler) {
+    if ( ! record->control_) {
+        using executor_type = net::associated_executor_t< Handler >;
+        record->control_ = std::make_shared< basic_fiber_control< executor_type > >(
+                record, net::get_associated_executor( handler) );
+    }
+    return * record->control_;
+}
+
+// Registers the deadline of the operation the fiber is about to suspend in,
+// if the operation was started with a deadline (with_deadline()). Once the
+// deadline has passed, the fiber's cancellation signal is emitted; the
+// operation is then reported as timed out if it failed with
+// operation_aborted.
+template< typename Handler >
+class deadline_scope {
+public:
+    deadline_scope( spawn_record * callee, Handler const& handler, std::chrono::steady_clock::time_point deadline) :
+            callee_{ callee } {
+        if ( std::chrono::steady_clock::time_point::max() == deadline) {
+            return;
+        }
+        auto ex = net::get_associated_executor( handler);
+        if ( nullptr == callee_->deadlines_) {
+            callee_->deadlines_ = & net::use_service< deadline_service >( context_of( ex, 0) );
+        }
+        entry_.expiry_ = deadline;
+        entry_.control_ = & control_of( callee_, handler);
+        entry_.seq_ = ++callee_->deadline_seq_;
+        callee_->deadline_pending_ = true;
+        callee_->deadline_expired_ = false;
+        callee_->deadlines_->add( entry_, ex);
+        service_ = callee_->deadlines_;
+    }
+
+    deadline_scope( deadline_scope const&) = delete;
+    deadline_scope & operator=( deadline_scope const&) = delete;
+
+    ~deadline_scope() {
+        release();
+    }
+
+    void finish( boost::system::error_code & ec) noexcept {
+        if ( release() && boost::asio::error::operation_aborted == ec) {
+            ec = boost::asio::error::timed_out;
+        }
+    }
+
+private:
+    spawn_record        *   callee_;
+    deadline_service    *   service_{ nullptr };
+    deadline_entry          entry_{};
+
+    // true if the deadline has expired
+    bool release() noexcept {
+        if ( nullptr == service_) {
+            return false;
+        }
+        std::exchange( service_, nullptr)->remove( entry_);
+        callee_->deadline_pending_ = false;
+        return std::exchange( callee_->deadline_expired_, false);
+    }
+};
+
+}
+
+template< typename Handler >
+fiber_handle basic_yield_context< Handler >::get_handle() const {
+    detail::control_of( callee_, handler_);
+    return fiber_handle{ callee_->control_ };
+}
+
+inline
+void fiber_handle::cancel() const {
+    if ( control_) {
+        control_->cancel();
+    }
+}
+
+namespace detail {
+
+// Runs the cleanup functions of the fiber-specific values when the fiber
+// function is left, whether by return, exception or forced_unwind.
+struct fss_cleanup_guard {
+    fss_slots   &   slots;
+
+    ~fss_cleanup_guard() {
+        slots.cleanup();
+    }
+};
+
+// The stack allocator handed to boost::context for a spawn_frame. The stack is
+// owned by the frame, which releases it once its last reference is gone.
+struct frame_stack_allocator {
+    void deallocate( boost::context::stack_context &) noexcept {
+    }
+};
+
+// Single allocation holding everything a spawned fiber needs: the fiber's
+// record, the completion handler, the fiber function and the stack allocator.
+// The frame is placed at the top of the fiber's stack, the way boost::context
+// places its own control structure, so spawning allocates nothing but the
+// stack.
 template< typename Handler, typename Function, typename StackAllocator >
-struct spawn_helper {
-    void operator()() {
-        callee_.reset(
-            new spawn_context{
+class spawn_frame : public spawn_record {
+public:
+    template< typename Hand, typename Func, typename Stack >
+    static spawn_frame * create( Hand && handler, bool call_handler, Func && function, Stack && salloc) {
+        boost::context::stack_context sctx = salloc.allocate();
+        return create( sctx, std::forward< Hand >( handler), call_handler,
+                std::forward< Func >( function), std::forward< Stack >( salloc) );
+    }
+
+    // Places the frame on a stack already obtained from salloc. The stack is
+    // released if the frame cannot be constructed.
+    template< typename Hand, typename Func, typename Stack >
+    static spawn_frame * create( boost::context::stack_context sctx, Hand && handler, bool call_handler, Func && function, Stack && salloc) {
+        // reserve space for the frame at the top of the stack
+        void * storage = reinterpret_cast< void * >(
+                ( reinterpret_cast< uintptr_t >( sctx.sp) - static_cast< uintptr_t >( sizeof( spawn_frame) ) )
+                & ~ static_cast< uintptr_t >( 0xff) );
+        spawn_frame * frame;
+        try {
+            frame = new ( storage) spawn_frame{
+                std::forward< Hand >( handler), call_handler,
+                std::forward< Func >( function),
+                std::forward< Stack >( salloc), sctx };
+        } catch (...) {
+            salloc.deallocate( sctx);
+            throw;
+        }
+#if defined(BOOST_SPAWN_ENABLE_STACK_PAINTING)
+        paint_stack( sctx, storage);
+#endif
+        const std::size_t size = reinterpret_cast< uintptr_t >( storage)
+            - ( reinterpret_cast< uintptr_t >( sctx.sp) - static_cast< uintptr_t >( sctx.size) );
+        frame->ctx_ = boost::context::fiber_context{
                 std::allocator_arg,
-                std::move( data_->salloc_),
-                [this] (boost::context::fiber_context && f) {
-                    std::shared_ptr< spawn_data< Handler, Function, StackAllocator > > data = data_;
-                    data->caller_.ctx_ = std::move( f);
-                    const basic_yield_context< Handler > yh{ callee_, data->caller_, data->handler_ };
+                boost::context::preallocated{ storage, size, sctx },
+                frame_stack_allocator{},
+                [frame] (boost::context::fiber_context && f) {
+                    frame->caller_.ctx_ = std::move( f);
+                    const basic_yield_context< Handler > yh{ frame, frame->caller_, frame->handler_ };
                     try {
-                        ( data->function_)( yh);
-                        if ( data->call_handler_) {
-                            ( data->handler_)();
+                        {
+                            // destroys the fiber-specific values, also on forced_unwind
+                            fss_cleanup_guard guard{ frame->fss_ };
+                            ( frame->function_)( yh);
+                        }
+                        if ( frame->call_handler_) {
+                            ( frame->handler_)();
                         }
                     } catch ( boost::context::detail::forced_unwind const& e) {
                         throw; // must allow forced_unwind to propagate
                     } catch (...) {
-                        auto callee = yh.callee_.lock();
-                        if ( callee) {
-                            callee->eptr_ = std::current_exception();
-                        }
+                        frame->eptr_ = std::current_exception();
                     }
-                    boost::context::fiber_context caller = std::move( data->caller_.ctx_);
-                    data.reset();
-                    return caller;
-                } } );
-        callee_->ctx_ = std::move( callee_->ctx_).resume();
-        if ( callee_->eptr_) {
-            std::rethrow_exception( std::move( callee_->eptr_) );
+                    return std::move( frame->caller_.ctx_);
+                } };
+        return frame;
+    }
+
+    std::size_t stack_size() const noexcept {
+        return sctx_.size;
+    }
+
+    Handler const& handler() const noexcept {
+        return handler_;
+    }
+
+private:
+    spawn_context                   caller_{};
+    Handler                         handler_;
+    bool                            call_handler_;
+    Function                        function_;
+    StackAllocator                  salloc_;
+    boost::context::stack_context   sctx_;
+
+    template< typename Hand, typename Func, typename Stack >
+    spawn_frame( Hand && handler, bool call_handler, Func && function, Stack && salloc,
+                 boost::context::stack_context sctx) :
+        handler_{ std::forward< Hand >( handler) },
+        call_handler_{ call_handler },
+        function_{ std::forward< Func >( function) },
+        salloc_{ std::forward< Stack >( salloc) },
+        sctx_{ sctx } {
+    }
+
+    void deallocate() noexcept override {
+        StackAllocator salloc = std::move( salloc_);
+        boost::context::stack_context sctx = sctx_;
+        this->~spawn_frame();
+#if defined(BOOST_SPAWN_ENABLE_STACK_PAINTING)
+        try {
+            stack_usage_registry::instance().record(
+                    typeid( Function), sctx.size, painted_usage( sctx) );
+        } catch (...) {
+            // measurement is best effort
         }
+#endif
+        salloc.deallocate( sctx);
     }
+};
 
-    std::shared_ptr< spawn_context >                                    callee_;
-    std::shared_ptr< spawn_data< Handler, Function, StackAllocator > >  data_;
+template< typename Handler, typename Function, typename StackAllocator >
+struct spawn_helper {
+    void operator()() {
+#if defined(BOOST_SPAWN_ENABLE_METRICS)
+        metrics_service & service = net::use_service< metrics_service >(
+                context_of( net::get_associated_executor( handler_), 0) );
+#endif
+        spawn_frame< Handler, Function, StackAllocator > * frame =
+            spawn_frame< Handler, Function, StackAllocator >::create(
+                    std::move( handler_), call_handler_,
+                    std::move( function_),
+                    std::move( salloc_) );
+        spawn_record_ptr< typename concurrency_policy< Handler >::type > callee{ frame };
+#if defined(BOOST_SPAWN_ENABLE_METRICS)
+        frame->metrics_.attach( service, frame->stack_size() );
+#endif
+        callee->resume();
+    }
+
+    Handler         handler_;
+    bool            call_handler_;
+    Function        function_;
+    StackAllocator  salloc_;
 };
 
 inline
@@ -414,16 +1074,31 @@ auto spawn_fiber( Handler && handler, Function && function, StackAllocator && sa
         >::type {
     using handler_type = typename std::decay< Handler >::type;
     using function_type = typename std::decay< Function >::type;
+    using salloc_type = typename std::decay< StackAllocator >::type;
 
     auto ex = boost::spawn::detail::net::get_associated_executor( handler);
     auto a = boost::spawn::detail::net::get_associated_allocator( handler);
-    boost::spawn::detail::spawn_helper< handler_type, function_type, StackAllocator > helper;
-    helper.data_ = std::make_shared<
-        boost::spawn::detail::spawn_data< handler_type, function_type, StackAllocator > >(
+    ex.dispatch(
+        boost::spawn::detail::spawn_helper< handler_type, function_type, salloc_type >{
                 std::forward< Handler >( handler), true,
                 std::forward< Function >( function),
-                std::forward< StackAllocator >( salloc) );
-    ex.dispatch( helper, a);
+                std::forward< StackAllocator >( salloc) },
+        a);
+}
+
+template< typename Handler, typename Function, typename StackAllocator >
+auto spawn_fiber( boost::spawn::single_threaded, Handler && handler, Function && function, StackAllocator && salloc)
+    -> typename std::enable_if<
+            ! boost::spawn::detail::net::is_executor< typename std::decay< Handler >::type >::value &&
+            ! std::is_convertible< Handler &, boost::spawn::detail::net::execution_context & >::value &&
+            ! boost::spawn::detail::is_stack_allocator< typename std::decay< Function >::type >::value &&
+            boost::spawn::detail::is_stack_allocator< typename std::decay< StackAllocator >::type >::value
+        >::type {
+    using handler_type = boost::spawn::detail::single_threaded_handler< typename std::decay< Handler >::type >;
+
+    spawn_fiber( handler_type{ std::forward< Handler >( handler) },
+            std::forward< Function >( function),
+            std::forward< StackAllocator >( salloc) );
 }
 
 template< typename Handler, typename Function, typename StackAllocator >
@@ -432,17 +1107,17 @@ auto spawn_fiber( boost::spawn::basic_yield_context< Handler > ctx, Function &&
             boost::spawn::detail::is_stack_allocator< typename std::decay< StackAllocator >::type >::value
         >::type {
     using function_type = typename std::decay< Function >::type;
+    using salloc_type = typename std::decay< StackAllocator >::type;
 
     Handler handler{ ctx.handler_ }; // Explicit copy that might be moved from.
     auto ex = boost::spawn::detail::net::get_associated_executor( handler);
     auto a = boost::spawn::detail::net::get_associated_allocator( handler);
-    boost::spawn::detail::spawn_helper< Handler, function_type, StackAllocator > helper;
-    helper.data_ = std::make_shared<
-        boost::spawn::detail::spawn_data< Handler, function_type, StackAllocator > >(
-                std::forward< Handler >( handler), false,
+    ex.dispatch(
+        boost::spawn::detail::spawn_helper< Handler, function_type, salloc_type >{
+                std::move( handler), false,
                 std::forward< Function >( function),
-                std::forward< StackAllocator >( salloc) );
-    ex.dispatch( helper, a);
+                std::forward< StackAllocator >( salloc) },
+        a);
 }
 
 template< typename Function, typename Executor, typename StackAllocator >
@@ -477,6 +1152,31 @@ auto spawn_fiber( ExecutionContext & ctx, Function && function, StackAllocator &
             std::forward< StackAllocator >( salloc) );
 }
 
+template< typename Function, typename Executor, typename StackAllocator >
+auto spawn_fiber( boost::spawn::single_threaded, Executor const& ex, Function && function, StackAllocator && salloc)
+    -> typename std::enable_if<
+            boost::spawn::detail::net::is_executor< Executor >::value &&
+            boost::spawn::detail::is_stack_allocator< typename std::decay< StackAllocator >::type >::value
+        >::type {
+    // no strand: the caller guarantees that ex runs one handler at a time
+    spawn_fiber( boost::spawn::single_threaded{},
+            bind_executor( ex, & boost::spawn::detail::default_spawn_handler),
+            std::forward< Function >( function),
+            std::forward< StackAllocator >( salloc) );
+}
+
+template< typename Function, typename ExecutionContext, typename StackAllocator >
+auto spawn_fiber( boost::spawn::single_threaded, ExecutionContext & ctx, Function && function, StackAllocator && salloc)
+    -> typename std::enable_if<
+            std::is_convertible< ExecutionContext &, boost::spawn::detail::net::execution_context & >::value &&
+            boost::spawn::detail::is_stack_allocator< typename std::decay< StackAllocator >::type >::value
+        >::type {
+    spawn_fiber( boost::spawn::single_threaded{},
+            ctx.get_executor(),
+            std::forward< Function >( function),
+            std::forward< StackAllocator >( salloc) );
+}
+
 }
 
 #endif // BOOST_SPAWN_IMPL_SPAWN_H
@@ -0,0 +1,231 @@
+//          Copyright Oliver Kowalke 2021.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef BOOST_SPAWN_METRICS_H
+#define BOOST_SPAWN_METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include <boost/asio/execution_context.hpp>
+
+// Runtime metrics of spawned fibers are collected only if the library is
+// compiled with BOOST_SPAWN_ENABLE_METRICS defined; otherwise the hooks are
+// compiled out and metrics_snapshot() returns empty metrics.
+
+namespace boost {
+namespace spawn {
+
+// counters of one live fiber; times are accumulated at context switches
+struct fiber_metrics {
+    std::uint64_t               id{ 0 };
+    std::uint64_t               resumes{ 0 };       // switches into the fiber
+    std::uint64_t               suspensions{ 0 };   // asynchronous operations the fiber waited for
+    std::uint64_t               exceptions{ 0 };    // exceptions propagated out of the fiber
+    std::chrono::nanoseconds    running{ 0 };
+    std::chrono::nanoseconds    suspended{ 0 };
+    std::size_t                 stack_size{ 0 };
+};
+
+// aggregate of all fibers spawned on executors of one execution context;
+// the totals include fibers that have already terminated
+struct executor_metrics {
+    std::size_t                 live_fibers{ 0 };
+    std::uint64_t               spawned{ 0 };
+    std::uint64_t               resumes{ 0 };
+    std::uint64_t               suspensions{ 0 };
+    std::uint64_t               exceptions{ 0 };
+    std::chrono::nanoseconds    running{ 0 };
+    std::chrono::nanoseconds    suspended{ 0 };
+    std::size_t                 stack_bytes{ 0 };   // reserved by live fibers
+    std::vector< fiber_metrics > fibers{};          // one entry per live fiber
+};
+
+namespace detail {
+
+template< typename T = void >
+class basic_metrics_service;
+
+using metrics_service = basic_metrics_service<>;
+
+// Per-fiber counters, embedded in the fiber's record. The counters are
+// written by the thread running the fiber and read by snapshots.
+class fiber_counters {
+public:
+    using clock_type = std::chrono::steady_clock;
+
+    fiber_counters() = default;
+
+    fiber_counters( fiber_counters const&) = delete;
+    fiber_counters & operator=( fiber_counters const&) = delete;
+
+    ~fiber_counters() {
+        detach();
+    }
+
+    inline void attach( metrics_service & service, std::size_t stack_size);
+
+    inline void detach() noexcept;
+
+    // the fiber is about to be resumed
+    void on_resume() noexcept {
+        clock_type::time_point now = clock_type::now();
+        if ( clock_type::time_point{} != last_) {
+            add( suspended_, now - last_);
+        }
+        last_ = now;
+        resumes_.fetch_add( 1, std::memory_order_relaxed);
+    }
+
+    // the fiber has suspended or terminated
+    void on_return( bool exception) noexcept {
+        clock_type::time_point now = clock_type::now();
+        add( running_, now - last_);
+        last_ = now;
+        if ( exception) {
+            exceptions_.fetch_add( 1, std::memory_order_relaxed);
+        }
+    }
+
+    // the fiber waits for an asynchronous operation
+    void on_suspend() noexcept {
+        suspensions_.fetch_add( 1, std::memory_order_relaxed);
+    }
+
+    fiber_metrics snapshot() const noexcept {
+        fiber_metrics m;
+        m.id = id_;
+        m.resumes = resumes_.load( std::memory_order_relaxed);
+        m.suspensions = suspensions_.load( std::memory_order_relaxed);
+        m.exceptions = exceptions_.load( std::memory_order_relaxed);
+        m.running = std::chrono::nanoseconds{ running_.load( std::memory_order_relaxed) };
+        m.suspended = std::chrono::nanoseconds{ suspended_.load( std::memory_order_relaxed) };
+        m.stack_size = stack_size_;
+        return m;
+    }
+
+private:
+    friend class basic_metrics_service<>;
+
+    metrics_service                 *   service_{ nullptr };
+    fiber_counters                  *   prev_{ nullptr };
+    fiber_counters                  *   next_{ nullptr };
+    std::uint64_t                       id_{ 0 };
+    std::size_t                         stack_size_{ 0 };
+    clock_type::time_point              last_{};
+    std::atomic< std::uint64_t >        resumes_{ 0 };
+    std::atomic< std::uint64_t >        suspensions_{ 0 };
+    std::atomic< std::uint64_t >        exceptions_{ 0 };
+    std::atomic< std::int64_t >         running_{ 0 };
+    std::atomic< std::int64_t >         suspended_{ 0 };
+
+    static void add( std::atomic< std::int64_t > & counter, clock_type::duration d) noexcept {
+        counter.fetch_add(
+                std::chrono::duration_cast< std::chrono::nanoseconds >( d).count(),
+                std::memory_order_relaxed);
+    }
+};
+
+// Execution context service holding the fibers spawned on executors of
+// that context. Terminated fibers are folded into the totals.
+template< typename T >
+class basic_metrics_service : public boost::asio::execution_context::service {
+public:
+    static boost::asio::execution_context::id id;
+
+    explicit basic_metrics_service( boost::asio::execution_context & ctx) :
+        boost::asio::execution_context::service{ ctx } {
+    }
+
+    void add( fiber_counters & c, std::size_t stack_size) {
+        std::unique_lock< std::mutex > lk{ mtx_ };
+        c.service_ = this;
+        c.id_ = ++totals_.spawned;
+        c.stack_size_ = stack_size;
+        c.next_ = head_;
+        if ( head_) {
+            head_->prev_ = & c;
+        }
+        head_ = & c;
+        ++totals_.live_fibers;
+        totals_.stack_bytes += stack_size;
+    }
+
+    void remove( fiber_counters & c) noexcept {
+        std::unique_lock< std::mutex > lk{ mtx_ };
+        if ( c.prev_) {
+            c.prev_->next_ = c.next_;
+        } else {
+            head_ = c.next_;
+        }
+        if ( c.next_) {
+            c.next_->prev_ = c.prev_;
+        }
+        c.prev_ = c.next_ = nullptr;
+        c.service_ = nullptr;
+        --totals_.live_fibers;
+        totals_.stack_bytes -= c.stack_size_;
+        accumulate( totals_, c.snapshot() );
+    }
+
+    executor_metrics snapshot() {
+        std::unique_lock< std::mutex > lk{ mtx_ };
+        executor_metrics m = totals_;
+        for ( fiber_counters * c = head_; nullptr != c; c = c->next_) {
+            fiber_metrics f = c->snapshot();
+            accumulate( m, f);
+            m.fibers.push_back( f);
+        }
+        return m;
+    }
+
+private:
+    std::mutex              mtx_{};
+    fiber_counters      *   head_{ nullptr };
+    executor_metrics        totals_{};
+
+    void shutdown() override {
+    }
+
+    static void accumulate( executor_metrics & m, fiber_metrics const& f) noexcept {
+        m.resumes += f.resumes;
+        m.suspensions += f.suspensions;
+        m.exceptions += f.exceptions;
+        m.running += f.running;
+        m.suspended += f.suspended;
+    }
+};
+
+template< typename T >
+boost::asio::execution_context::id basic_metrics_service< T >::id;
+
+void fiber_counters::attach( metrics_service & service, std::size_t stack_size) {
+    service.add( * this, stack_size);
+}
+
+void fiber_counters::detach() noexcept {
+    if ( service_) {
+        service_->remove( * this);
+    }
+}
+
+}
+
+// metrics of the fibers spawned on executors of ctx
+inline
+executor_metrics metrics_snapshot( boost::asio::execution_context & ctx) {
+    if ( ! boost::asio::has_service< detail::metrics_service >( ctx) ) {
+        return executor_metrics{};
+    }
+    return boost::asio::use_service< detail::metrics_service >( ctx).snapshot();
+}
+
+}}
+
+#endif // BOOST_SPAWN_METRICS_H
@@ -0,0 +1,130 @@
+//          Copyright Oliver Kowalke 2021.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef BOOST_SPAWN_MUTEX_H
+#define BOOST_SPAWN_MUTEX_H
+
+#include <atomic>
+#include <mutex>
+
+#include <boost/assert.hpp>
+
+#include <boost/spawn.hpp>
+#include <boost/spawn/detail/wait_queue.hpp>
+
+namespace boost {
+namespace spawn {
+
+// Mutex for spawned fibers. lock() suspends the calling fiber instead of
+// blocking the thread, so other fibers keep running on it. Locking and
+// unlocking without contention is a single compare-and-swap each.
+// Ownership is handed to the waiters in FIFO order; a waiter is resumed
+// through its own executor. May be shared by fibers on different strands
+// and threads.
+class mutex {
+public:
+    mutex() = default;
+
+    mutex( mutex const&) = delete;
+    mutex & operator=( mutex const&) = delete;
+
+    // fibers still waiting are unwound
+    ~mutex() {
+        detail::destroy_all( waiters_.pop_all() );
+    }
+
+    // fails with operation_aborted if the wait is cancelled
+    template< typename Handler >
+    void lock( basic_yield_context< Handler > const& yield) {
+        if ( try_lock() ) {
+            detail::complete_now( yield, boost::system::error_code{} );
+            return;
+        }
+        detail::wait( yield,
+            [this] ( detail::waiter & w, boost::system::error_code &) {
+                return enqueue( w);
+            },
+            [this] ( detail::waiter & w) {
+                std::unique_lock< detail::spinlock > lk{ splk_ };
+                return waiters_.remove( w);
+            });
+    }
+
+    bool try_lock() noexcept {
+        int s = unlocked;
+        return state_.compare_exchange_strong( s, locked, std::memory_order_acquire, std::memory_order_relaxed);
+    }
+
+    void unlock() {
+        int s = locked;
+        if ( state_.compare_exchange_strong( s, unlocked, std::memory_order_release, std::memory_order_relaxed) ) {
+            return;
+        }
+        BOOST_ASSERT_MSG( contended == s, "mutex is not locked");
+        detail::waiter * w;
+        {
+            std::unique_lock< detail::spinlock > lk{ splk_ };
+            w = waiters_.pop();
+            if ( nullptr == w) {
+                state_.store( unlocked, std::memory_order_release);
+                return;
+            }
+            // ownership passes to w
+            if ( waiters_.empty() ) {
+                state_.store( locked, std::memory_order_relaxed);
+            }
+        }
+        w->complete();
+    }
+
+private:
+    friend class condition_variable;
+
+    enum {
+        unlocked = 0,
+        locked,
+        contended   // locked, fibers may be waiting
+    };
+
+    std::atomic< int >  state_{ unlocked };
+    detail::spinlock    splk_{};
+    detail::wait_queue  waiters_{};
+
+    // false if the mutex has been locked instead
+    bool enqueue( detail::waiter & w) {
+        std::unique_lock< detail::spinlock > lk{ splk_ };
+        int s = state_.load( std::memory_order_relaxed);
+        for (;;) {
+            if ( unlocked == s) {
+                if ( state_.compare_exchange_weak( s, locked, std::memory_order_acquire, std::memory_order_relaxed) ) {
+                    return false;
+                }
+            } else if ( locked == s) {
+                // the owner's unlock() takes the slow path from now on
+                state_.compare_exchange_weak( s, contended, std::memory_order_relaxed);
+            } else {
+                waiters_.push( w);
+                return true;
+            }
+        }
+    }
+
+    // not cancellable: used by condition_variable::wait(), which must
+    // return with the mutex locked
+    template< typename Handler >
+    void relock( basic_yield_context< Handler > const& yield) {
+        if ( try_lock() ) {
+            detail::complete_now( yield, boost::system::error_code{} );
+            return;
+        }
+        detail::wait( yield, [this] ( detail::waiter & w, boost::system::error_code &) {
+            return enqueue( w);
+        });
+    }
+};
+
+}}
+
+#endif // BOOST_SPAWN_MUTEX_H
@@ -0,0 +1,223 @@
+//          Copyright Oliver Kowalke 2021.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef BOOST_SPAWN_POOLED_STACK_H
+#define BOOST_SPAWN_POOLED_STACK_H
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <boost/assert.hpp>
+#include <boost/context/protected_fixedsize_stack.hpp>
+#include <boost/context/stack_context.hpp>
+#include <boost/context/stack_traits.hpp>
+#include <boost/intrusive_ptr.hpp>
+
+namespace boost {
+namespace spawn {
+
+// Snapshot of the counters maintained by a basic_pooled_stack.
+struct pooled_stack_statistics {
+    std::size_t     thread_hits{ 0 };   // allocations served from the calling thread's free list
+    std::size_t     global_hits{ 0 };   // allocations served from the shared spill list
+    std::size_t     misses{ 0 };        // allocations that had to map a fresh stack
+    std::size_t     spills{ 0 };        // deallocations moved to the shared spill list
+    std::size_t     releases{ 0 };      // deallocations returned to the operating system
+    std::size_t     global_cached{ 0 }; // stacks currently held by the shared spill list
+};
+
+// Stack allocator that recycles stacks instead of mapping and unmapping them
+// for each fiber. Stacks are obtained from basic_protected_fixedsize_stack, so
+// every stack keeps its guard page while it sits in the pool.
+// Released stacks go to a free list owned by the releasing thread; if that
+// list is full they spill to a list shared by all threads, which is bounded
+// as well. Stacks that do not fit into either list are unmapped.
+// Copies of a basic_pooled_stack share the same pool.
+// The free list of a thread keeps the pool alive: stacks cached by a thread
+// stay mapped after the last copy of the basic_pooled_stack is destroyed,
+// until that thread exits.
+template< typename traitsT >
+class basic_pooled_stack {
+private:
+    class storage;
+
+    struct thread_cache {
+        struct entry {
+            boost::intrusive_ptr< storage >     pool;
+            std::vector< context::stack_context > stacks;
+        };
+
+        std::vector< entry >    entries;
+
+        ~thread_cache() {
+            for ( entry & e : entries) {
+                for ( context::stack_context & sctx : e.stacks) {
+                    e.pool->spill( sctx);
+                }
+            }
+        }
+
+        entry * find( storage const* pool) noexcept {
+            for ( entry & e : entries) {
+                if ( e.pool.get() == pool) {
+                    return & e;
+                }
+            }
+            return nullptr;
+        }
+    };
+
+    static thread_cache & local_cache() noexcept {
+        static thread_local thread_cache cache;
+        return cache;
+    }
+
+    class storage {
+    private:
+        std::atomic< std::size_t >                                  use_count_;
+        context::basic_protected_fixedsize_stack< traitsT >         salloc_;
+        std::size_t                                                 max_thread_cached_;
+        std::size_t                                                 max_global_cached_;
+        std::mutex                                                  mtx_{};
+        std::vector< context::stack_context >                       global_{};
+        std::atomic< std::size_t >                                  thread_hits_{ 0 };
+        std::atomic< std::size_t >                                  global_hits_{ 0 };
+        std::atomic< std::size_t >                                  misses_{ 0 };
+        std::atomic< std::size_t >                                  spills_{ 0 };
+        std::atomic< std::size_t >                                  releases_{ 0 };
+
+    public:
+        storage( std::size_t stack_size, std::size_t max_thread_cached, std::size_t max_global_cached) :
+                use_count_{ 0 },
+                salloc_{ stack_size },
+                max_thread_cached_{ max_thread_cached },
+                max_global_cached_{ max_global_cached } {
+            BOOST_ASSERT( traitsT::is_unbounded() || ( traitsT::maximum_size() >= stack_size) );
+            global_.reserve( max_global_cached_);
+        }
+
+        ~storage() {
+            for ( context::stack_context & sctx : global_) {
+                salloc_.deallocate( sctx);
+            }
+        }
+
+        context::stack_context allocate() {
+            typename thread_cache::entry * e = local_cache().find( this);
+            if ( e && ! e->stacks.empty() ) {
+                context::stack_context sctx = e->stacks.back();
+                e->stacks.pop_back();
+                thread_hits_.fetch_add( 1, std::memory_order_relaxed);
+                return sctx;
+            }
+            {
+                std::unique_lock< std::mutex > lk{ mtx_ };
+                if ( ! global_.empty() ) {
+                    context::stack_context sctx = global_.back();
+                    global_.pop_back();
+                    lk.unlock();
+                    global_hits_.fetch_add( 1, std::memory_order_relaxed);
+                    return sctx;
+                }
+            }
+            misses_.fetch_add( 1, std::memory_order_relaxed);
+            return salloc_.allocate();
+        }
+
+        void deallocate( context::stack_context & sctx) noexcept {
+            BOOST_ASSERT( sctx.sp);
+            typename thread_cache::entry * e = local_cache().find( this);
+            if ( ! e && 0 < max_thread_cached_) {
+                try {
+                    // completed before it is inserted: a failure leaves no
+                    // entry without a pool behind
+                    typename thread_cache::entry tmp;
+                    tmp.stacks.reserve( max_thread_cached_);
+                    tmp.pool.reset( this);
+                    thread_cache & cache = local_cache();
+                    cache.entries.push_back( std::move( tmp) );
+                    e = & cache.entries.back();
+                } catch (...) {
+                    e = nullptr;
+                }
+            }
+            if ( e && e->stacks.size() < max_thread_cached_) {
+                // capacity was reserved up front, push_back does not allocate
+                e->stacks.push_back( sctx);
+                return;
+            }
+            spill( sctx);
+        }
+
+        void spill( context::stack_context & sctx) noexcept {
+            {
+                std::unique_lock< std::mutex > lk{ mtx_ };
+                if ( global_.size() < max_global_cached_) {
+                    global_.push_back( sctx);
+                    lk.unlock();
+                    spills_.fetch_add( 1, std::memory_order_relaxed);
+                    return;
+                }
+            }
+            releases_.fetch_add( 1, std::memory_order_relaxed);
+            salloc_.deallocate( sctx);
+        }
+
+        pooled_stack_statistics statistics() {
+            pooled_stack_statistics stats;
+            stats.thread_hits = thread_hits_.load( std::memory_order_relaxed);
+            stats.global_hits = global_hits_.load( std::memory_order_relaxed);
+            stats.misses = misses_.load( std::memory_order_relaxed);
+            stats.spills = spills_.load( std::memory_order_relaxed);
+            stats.releases = releases_.load( std::memory_order_relaxed);
+            std::unique_lock< std::mutex > lk{ mtx_ };
+            stats.global_cached = global_.size();
+            return stats;
+        }
+
+        friend void intrusive_ptr_add_ref( storage * s) noexcept {
+            ++s->use_count_;
+        }
+
+        friend void intrusive_ptr_release( storage * s) noexcept {
+            if ( 0 == --s->use_count_) {
+                delete s;
+            }
+        }
+    };
+
+    boost::intrusive_ptr< storage >     storage_;
+
+public:
+    typedef traitsT traits_type;
+
+    basic_pooled_stack( std::size_t stack_size = traits_type::default_size(),
+                        std::size_t max_thread_cached = 16,
+                        std::size_t max_global_cached = 256) :
+        storage_{ new storage{ stack_size, max_thread_cached, max_global_cached } } {
+    }
+
+    context::stack_context allocate() {
+        return storage_->allocate();
+    }
+
+    void deallocate( context::stack_context & sctx) noexcept {
+        storage_->deallocate( sctx);
+    }
+
+    // locks the shared spill list
+    pooled_stack_statistics statistics() const {
+        return storage_->statistics();
+    }
+};
+
+typedef basic_pooled_stack< boost::context::stack_traits >  pooled_stack;
+
+}}
+
+#endif // BOOST_SPAWN_POOLED_STACK_H
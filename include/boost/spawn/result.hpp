@@ -0,0 +1,127 @@
+//          Copyright Oliver Kowalke 2021.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef BOOST_SPAWN_RESULT_H
+#define BOOST_SPAWN_RESULT_H
+
+#include <utility>
+
+#include <boost/system/error_code.hpp>
+#include <boost/system/system_error.hpp>
+
+namespace boost {
+namespace spawn {
+
+// Outcome of an asynchronous operation started with
+// basic_yield_context::as_result(): the error_code and the value passed to
+// the completion handler, a std::tuple if there are several. Unlike
+// expected< T, error_code >, the value is kept if the operation has failed,
+// e.g. the bytes transferred before a read reached the end of the stream.
+template< typename T >
+class result {
+public:
+    using value_type = T;
+
+    result( boost::system::error_code ec, T && value) :
+        ec_{ ec },
+        value_( std::move( value) ) {
+    }
+
+    bool has_value() const noexcept {
+        return ! ec_;
+    }
+
+    explicit operator bool() const noexcept {
+        return has_value();
+    }
+
+    boost::system::error_code error() const noexcept {
+        return ec_;
+    }
+
+    // Throws system_error if the operation has failed.
+    T & value() & {
+        check();
+        return value_;
+    }
+
+    T const& value() const& {
+        check();
+        return value_;
+    }
+
+    T && value() && {
+        check();
+        return std::move( value_);
+    }
+
+    // Unchecked access, also valid if the operation has failed.
+    T & operator*() & noexcept {
+        return value_;
+    }
+
+    T const& operator*() const& noexcept {
+        return value_;
+    }
+
+    T && operator*() && noexcept {
+        return std::move( value_);
+    }
+
+    T * operator->() noexcept {
+        return & value_;
+    }
+
+    T const* operator->() const noexcept {
+        return & value_;
+    }
+
+private:
+    boost::system::error_code   ec_;
+    T                           value_;
+
+    void check() const {
+        if ( ec_) {
+            throw boost::system::system_error( ec_);
+        }
+    }
+};
+
+// Outcome of an operation completing without a value.
+template<>
+class result< void > {
+public:
+    using value_type = void;
+
+    explicit result( boost::system::error_code ec) noexcept :
+        ec_{ ec } {
+    }
+
+    bool has_value() const noexcept {
+        return ! ec_;
+    }
+
+    explicit operator bool() const noexcept {
+        return has_value();
+    }
+
+    boost::system::error_code error() const noexcept {
+        return ec_;
+    }
+
+    // Throws system_error if the operation has failed.
+    void value() const {
+        if ( ec_) {
+            throw boost::system::system_error( ec_);
+        }
+    }
+
+private:
+    boost::system::error_code   ec_;
+};
+
+}}
+
+#endif // BOOST_SPAWN_RESULT_H
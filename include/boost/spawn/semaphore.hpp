@@ -0,0 +1,103 @@
+//          Copyright Oliver Kowalke 2021.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef BOOST_SPAWN_SEMAPHORE_H
+#define BOOST_SPAWN_SEMAPHORE_H
+
+#include <cstddef>
+#include <mutex>
+
+#include <boost/spawn.hpp>
+#include <boost/spawn/detail/wait_queue.hpp>
+
+namespace boost {
+namespace spawn {
+
+// Counting semaphore for spawned fibers. acquire() suspends the calling
+// fiber while the count is zero instead of blocking the thread. Released
+// units are handed to the waiters in FIFO order.
+class semaphore {
+public:
+    explicit semaphore( std::size_t count = 0) noexcept :
+        count_{ count } {
+    }
+
+    semaphore( semaphore const&) = delete;
+    semaphore & operator=( semaphore const&) = delete;
+
+    // fibers still waiting are unwound
+    ~semaphore() {
+        detail::destroy_all( waiters_.pop_all() );
+    }
+
+    // fails with operation_aborted if the wait is cancelled
+    template< typename Handler >
+    void acquire( basic_yield_context< Handler > const& yield) {
+        if ( try_acquire() ) {
+            detail::complete_now( yield, boost::system::error_code{} );
+            return;
+        }
+        detail::wait( yield,
+            [this] ( detail::waiter & w, boost::system::error_code &) {
+                std::unique_lock< detail::spinlock > lk{ splk_ };
+                if ( 0 < count_) {
+                    --count_;
+                    return false;
+                }
+                waiters_.push( w);
+                return true;
+            },
+            [this] ( detail::waiter & w) {
+                std::unique_lock< detail::spinlock > lk{ splk_ };
+                return waiters_.remove( w);
+            });
+    }
+
+    bool try_acquire() noexcept {
+        std::unique_lock< detail::spinlock > lk{ splk_ };
+        if ( 0 == count_) {
+            return false;
+        }
+        --count_;
+        return true;
+    }
+
+    void release( std::size_t n = 1) {
+        detail::waiter * head = nullptr;
+        detail::waiter * tail = nullptr;
+        {
+            std::unique_lock< detail::spinlock > lk{ splk_ };
+            for ( ; 0 < n; --n) {
+                detail::waiter * w = waiters_.pop();
+                if ( nullptr == w) {
+                    break;
+                }
+                // the unit passes to w
+                if ( nullptr == tail) {
+                    head = w;
+                } else {
+                    tail->next_ = w;
+                }
+                tail = w;
+            }
+            count_ += n;
+        }
+        detail::complete_all( head);
+    }
+
+    std::size_t count() const noexcept {
+        std::unique_lock< detail::spinlock > lk{ splk_ };
+        return count_;
+    }
+
+private:
+    mutable detail::spinlock    splk_{};
+    std::size_t                 count_;
+    detail::wait_queue          waiters_{};
+};
+
+}}
+
+#endif // BOOST_SPAWN_SEMAPHORE_H
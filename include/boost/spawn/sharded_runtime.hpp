@@ -0,0 +1,498 @@
+//          Copyright Oliver Kowalke 2021.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef BOOST_SPAWN_SHARDED_RUNTIME_H
+#define BOOST_SPAWN_SHARDED_RUNTIME_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/assert.hpp>
+#include <boost/config.hpp>
+#include <boost/optional.hpp>
+
+#include <boost/spawn.hpp>
+#include <boost/spawn/detail/spsc_queue.hpp>
+
+namespace boost {
+namespace spawn {
+
+class sharded_runtime;
+
+namespace detail {
+
+// Message between the shards of a sharded_runtime
+class shard_message {
+public:
+    // runs on the thread of the receiving shard
+    virtual void deliver( sharded_runtime & rt) = 0;
+
+    // the runtime is destroyed before the message was delivered
+    virtual void destroy() noexcept = 0;
+
+protected:
+    ~shard_message() = default;
+};
+
+// Delivers a message posted to the io_context of a shard. If the
+// io_context is destroyed with the handler, the message is destroyed.
+class posted_message {
+public:
+    posted_message( sharded_runtime & rt, shard_message & m) noexcept :
+        rt_{ & rt },
+        m_{ & m } {
+    }
+
+    posted_message( posted_message && other) noexcept :
+        rt_{ other.rt_ },
+        m_{ std::exchange( other.m_, nullptr) } {
+    }
+
+    posted_message & operator=( posted_message &&) = delete;
+
+    ~posted_message() {
+        if ( nullptr != m_) {
+            m_->destroy();
+        }
+    }
+
+    void operator()() {
+        std::exchange( m_, nullptr)->deliver( * rt_);
+    }
+
+private:
+    sharded_runtime     *   rt_;
+    shard_message       *   m_;
+};
+
+template< typename Function >
+class spawn_message final : public shard_message {
+public:
+    spawn_message( std::size_t shard, Function && fn) :
+        shard_{ shard },
+        fn_{ std::move( fn) } {
+    }
+
+    void deliver( sharded_runtime & rt) override;
+
+    void destroy() noexcept override {
+        delete this;
+    }
+
+private:
+    std::size_t     shard_;
+    Function        fn_;
+};
+
+// Result of a function called on another shard; R is void or an object type
+template< typename R >
+class call_result {
+public:
+    template< typename Function >
+    void run( Function & fn) {
+        value_.emplace( fn() );
+    }
+
+    R get() {
+        return std::move( * value_);
+    }
+
+private:
+    boost::optional< R >    value_{};
+};
+
+template<>
+class call_result< void > {
+public:
+    template< typename Function >
+    void run( Function & fn) {
+        fn();
+    }
+
+    void get() {
+    }
+};
+
+// Lives on the stack of the calling fiber, which is suspended until the
+// message has been delivered back to it.
+template< typename Function, typename R, typename Handler >
+class call_message final : public shard_message {
+public:
+    call_message( std::size_t origin, Function & fn, Handler && handler) :
+        origin_{ origin },
+        fn_{ fn },
+        handler_{ std::move( handler) } {
+    }
+
+    void deliver( sharded_runtime & rt) override;
+
+    void destroy() noexcept override {
+        // unwinds the suspended caller
+        Handler h{ std::move( handler_) };
+    }
+
+    R get() {
+        if ( eptr_) {
+            std::rethrow_exception( eptr_);
+        }
+        return result_.get();
+    }
+
+private:
+    std::size_t             origin_;
+    Function            &   fn_;
+    Handler                 handler_;
+    call_result< R >        result_{};
+    std::exception_ptr      eptr_{};
+    bool                    returned_{ false };
+};
+
+// Holds sharded_runtime::npos. A class template, so that the definition
+// below may appear in every translation unit (C++14 has no inline
+// variables).
+template< typename T = void >
+struct sharded_runtime_base {
+    static constexpr std::size_t npos = static_cast< std::size_t >( -1);
+};
+
+template< typename T >
+constexpr std::size_t sharded_runtime_base< T >::npos;
+
+}
+
+// Runs one io_context per shard, each on its own thread, pinned to a core
+// where the platform supports it. Fibers are spawned on a shard with
+// spawn_on() and stay there; a shard runs one handler at a time, so its
+// fibers use the single_threaded policy and need no strand.
+//
+// Shards talk to each other through a lock-free single-producer/single-
+// consumer queue per ordered pair of shards. call_on() sends a message that
+// lives on the calling fiber's stack: a call between shards allocates
+// nothing. Messages sent from threads outside the runtime, and messages
+// that find their queue full, are posted to the receiving io_context
+// instead.
+//
+// Like asio::thread_pool, the threads keep running until join() is called
+// and the fibers spawned with spawn_on() as well as all calls in flight
+// have finished, or until stop() is called.
+class sharded_runtime : public detail::sharded_runtime_base<> {
+public:
+    using detail::sharded_runtime_base<>::npos;
+
+    explicit sharded_runtime( std::size_t shards = default_shards(), std::size_t queue_capacity = 1024) :
+            shards_( std::max< std::size_t >( 1, shards) ) {
+        const std::size_t n = shards_.size();
+        queues_.reserve( n * n);
+        for ( std::size_t i = 0; i < n * n; ++i) {
+            // queues from a shard to itself stay unused
+            queues_.emplace_back( new detail::spsc_queue< detail::shard_message >{ i / n != i % n ? queue_capacity : 1 } );
+        }
+        try {
+            for ( std::size_t i = 0; i < n; ++i) {
+                shards_[ i].thread = std::thread{ [this,i] { run( i); } };
+            }
+        } catch (...) {
+            stop();
+            join();
+            throw;
+        }
+    }
+
+    sharded_runtime( sharded_runtime const&) = delete;
+    sharded_runtime & operator=( sharded_runtime const&) = delete;
+
+    // messages not delivered yet are destroyed; fibers still suspended in
+    // call_on() are unwound
+    ~sharded_runtime() {
+        stop();
+        join();
+        for ( auto & q : queues_) {
+            while ( detail::shard_message * m = q->pop() ) {
+                m->destroy();
+            }
+        }
+        // destroys the pending handlers while all shards and the work count
+        // still exist: an unwound fiber releases its work on every shard
+        for ( shard & s : shards_) {
+            s.ioc.shutdown();
+        }
+    }
+
+    std::size_t size() const noexcept {
+        return shards_.size();
+    }
+
+    boost::asio::io_context & context( std::size_t shard) noexcept {
+        BOOST_ASSERT( shard < shards_.size() );
+        return shards_[ shard].ioc;
+    }
+
+    // shard of the calling thread, or npos
+    std::size_t current_shard() const noexcept {
+        thread_info * info = current();
+        return nullptr != info && this == info->rt ? info->index : npos;
+    }
+
+    // spawns a fiber running fn( yield) on shard; may be called from any thread
+    template< typename Function >
+    void spawn_on( std::size_t shard, Function && fn) {
+        BOOST_ASSERT( shard < shards_.size() );
+        using function_type = counted_function< typename std::decay< Function >::type >;
+        function_type counted{ work_guard{ * this }, std::forward< Function >( fn) };
+        if ( current_shard() == shard) {
+            spawn_fiber( single_threaded{}, context( shard), std::move( counted) );
+            return;
+        }
+        send( shard, * new detail::spawn_message< function_type >{ shard, std::move( counted) });
+    }
+
+    // Runs fn() on shard and returns its result to the calling fiber, which
+    // is suspended meanwhile. An exception thrown by fn() is rethrown here.
+    // Runs fn() directly if the fiber runs on shard itself.
+    template< typename Function, typename Handler >
+    auto call_on( std::size_t shard, Function && fn, basic_yield_context< Handler > const& yield)
+            -> decltype( fn() ) {
+        BOOST_ASSERT( shard < shards_.size() );
+        using result_type = decltype( fn() );
+        const std::size_t origin = current_shard();
+        if ( origin == shard) {
+            return fn();
+        }
+        // keeps the called shard running until the result is back
+        work_guard work{ * this };
+        using token_type = basic_yield_context< Handler >;
+        token_type token{ yield };
+        boost::asio::async_completion< token_type, void() > init{ token };
+        using handler_type = typename boost::asio::async_completion< token_type, void() >::completion_handler_type;
+        // keeps the context of the caller running, like any asynchronous operation
+        auto caller_work = boost::asio::make_work_guard( init.completion_handler);
+        detail::call_message< Function, result_type, handler_type > m{ origin, fn, std::move( init.completion_handler) };
+        send( shard, m);
+        init.result.get();
+        return m.get();
+    }
+
+    // the threads exit as soon as they have finished their current handler
+    void stop() {
+        for ( shard & s : shards_) {
+            s.ioc.stop();
+        }
+    }
+
+    // waits for the threads to exit
+    void join() {
+        if ( ! joined_.exchange( true) ) {
+            work_finished();
+        }
+        for ( shard & s : shards_) {
+            if ( s.thread.joinable() ) {
+                s.thread.join();
+            }
+        }
+    }
+
+    static std::size_t default_shards() noexcept {
+        return std::max< unsigned int >( 1, std::thread::hardware_concurrency() );
+    }
+
+private:
+    template< typename Function >
+    friend class detail::spawn_message;
+    template< typename Function, typename R, typename Handler >
+    friend class detail::call_message;
+
+    struct thread_info {
+        sharded_runtime     *   rt;
+        std::size_t             index;
+    };
+
+    // work of the runtime, counted like the work of an io_context
+    class work_guard {
+    public:
+        explicit work_guard( sharded_runtime & rt) noexcept :
+            rt_{ & rt } {
+            rt_->outstanding_.fetch_add( 1, std::memory_order_relaxed);
+        }
+
+        work_guard( work_guard && other) noexcept :
+            rt_{ std::exchange( other.rt_, nullptr) } {
+        }
+
+        work_guard & operator=( work_guard &&) = delete;
+
+        ~work_guard() {
+            if ( nullptr != rt_) {
+                rt_->work_finished();
+            }
+        }
+
+    private:
+        sharded_runtime *   rt_;
+    };
+
+    // fiber function spawned by spawn_on(); the fiber counts as work
+    // until the function is destroyed
+    template< typename Function >
+    class counted_function {
+    public:
+        template< typename F >
+        counted_function( work_guard && work, F && fn) :
+            work_{ std::move( work) },
+            fn_( std::forward< F >( fn) ) {
+        }
+
+        template< typename Handler >
+        void operator()( basic_yield_context< Handler > yield) {
+            fn_( yield);
+        }
+
+    private:
+        work_guard  work_;
+        Function    fn_;
+    };
+
+    // io_context whose handlers can be destroyed before the destructor runs,
+    // like asio::thread_pool does
+    class shard_context : public boost::asio::io_context {
+    public:
+        using boost::asio::io_context::io_context;
+        using boost::asio::execution_context::shutdown;
+    };
+
+    struct shard {
+        shard() {
+            // released by work_finished()
+            ioc.get_executor().on_work_started();
+        }
+
+        shard_context               ioc{ 1 };
+        std::thread                 thread{};
+        // a drain() is pending
+        std::atomic< bool >         notified{ false };
+    };
+
+    std::vector< shard >                                                        shards_;
+    std::vector< std::unique_ptr< detail::spsc_queue< detail::shard_message > > > queues_{};
+    std::atomic< std::size_t >                                                  outstanding_{ 1 };
+    std::atomic< bool >                                                         joined_{ false };
+
+    BOOST_NOINLINE static
+    thread_info *& current() noexcept {
+        static thread_local thread_info * info = nullptr;
+        return info;
+    }
+
+    void work_finished() noexcept {
+        if ( 1 == outstanding_.fetch_sub( 1, std::memory_order_acq_rel) ) {
+            // the shards exit once they have run out of handlers
+            for ( shard & s : shards_) {
+                s.ioc.get_executor().on_work_finished();
+            }
+        }
+    }
+
+    detail::spsc_queue< detail::shard_message > & queue( std::size_t from, std::size_t to) noexcept {
+        return * queues_[ from * shards_.size() + to];
+    }
+
+    void send( std::size_t to, detail::shard_message & m) {
+        const std::size_t from = current_shard();
+        if ( npos == from || ! queue( from, to).push( & m) ) {
+            boost::asio::post( context( to), detail::posted_message{ * this, m });
+            return;
+        }
+        // at most one drain() is queued per shard
+        if ( ! shards_[ to].notified.exchange( true) ) {
+            boost::asio::post( context( to), [this,to] { drain( to); });
+        }
+    }
+
+    void drain( std::size_t to) {
+        // reset first: a message pushed from now on queues a new drain();
+        // the exchange also makes the messages pushed so far visible
+        shards_[ to].notified.exchange( false);
+        for ( std::size_t from = 0; from < shards_.size(); ++from) {
+            if ( from == to) {
+                continue;
+            }
+            detail::spsc_queue< detail::shard_message > & q = queue( from, to);
+            while ( detail::shard_message * m = q.pop() ) {
+                m->deliver( * this);
+            }
+        }
+    }
+
+    void run( std::size_t index) {
+#if defined(__linux__)
+        const unsigned int cores = std::thread::hardware_concurrency();
+        if ( 0 < cores) {
+            cpu_set_t set;
+            CPU_ZERO( & set);
+            CPU_SET( index % cores, & set);
+            // best effort: the shard still runs if the core is not available
+            ::pthread_setaffinity_np( ::pthread_self(), sizeof( set), & set);
+        }
+#endif
+        thread_info info{ this, index };
+        current() = & info;
+        shards_[ index].ioc.run();
+        current() = nullptr;
+    }
+};
+
+namespace detail {
+
+template< typename Function >
+void spawn_message< Function >::deliver( sharded_runtime & rt) {
+    std::unique_ptr< spawn_message > self{ this };
+    spawn_fiber( single_threaded{}, rt.context( shard_), std::move( fn_) );
+}
+
+template< typename Function, typename R, typename Handler >
+void call_message< Function, R, Handler >::deliver( sharded_runtime & rt) {
+    if ( ! returned_) {
+        // on the called shard
+        try {
+            result_.run( fn_);
+        } catch (...) {
+            eptr_ = std::current_exception();
+        }
+        returned_ = true;
+        if ( sharded_runtime::npos == origin_) {
+            // the caller does not run on a shard
+            Handler h{ std::move( handler_) };
+            boost::asio::post( std::move( h) );
+        } else {
+            rt.send( origin_, * this);
+        }
+        return;
+    }
+    // back on the calling shard; resuming the caller destroys this message
+    Handler h{ std::move( handler_) };
+    boost::asio::dispatch( std::move( h) );
+}
+
+}
+
+}}
+
+#endif // BOOST_SPAWN_SHARDED_RUNTIME_H
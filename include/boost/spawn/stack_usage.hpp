@@ -0,0 +1,155 @@
+//          Copyright Oliver Kowalke 2021.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef BOOST_SPAWN_STACK_USAGE_H
+#define BOOST_SPAWN_STACK_USAGE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <typeindex>
+#include <typeinfo>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/context/stack_context.hpp>
+#include <boost/context/stack_traits.hpp>
+#include <boost/core/demangle.hpp>
+
+// If the library is compiled with BOOST_SPAWN_ENABLE_STACK_PAINTING defined,
+// the stack of every spawned fiber is filled with a pattern before the fiber
+// starts. When the fiber's stack is released, the deepest byte that no longer
+// holds the pattern gives the stack's high-water mark. The marks are
+// aggregated per type of the fiber function. Painting touches every page of
+// the stack, so this mode is meant for sizing runs, not for production.
+
+namespace boost {
+namespace spawn {
+
+// high-water marks of the fibers running one function type
+struct stack_usage {
+    std::string     function{};         // demangled type of the fiber function
+    std::uint64_t   fibers{ 0 };        // terminated fibers measured
+    std::size_t     stack_size{ 0 };    // largest stack allocated
+    std::size_t     max_used{ 0 };      // deepest use of any of the fibers
+    std::size_t     total_used{ 0 };    // sum over all fibers, for the mean
+};
+
+namespace detail {
+
+class stack_usage_registry {
+public:
+    static stack_usage_registry & instance() {
+        static stack_usage_registry registry;
+        return registry;
+    }
+
+    void record( std::type_info const& ti, std::size_t stack_size, std::size_t used) {
+        std::unique_lock< std::mutex > lk{ mtx_ };
+        stack_usage & u = usage_[ std::type_index{ ti } ];
+        if ( u.function.empty() ) {
+            u.function = boost::core::demangle( ti.name() );
+        }
+        ++u.fibers;
+        u.stack_size = ( std::max)( u.stack_size, stack_size);
+        u.max_used = ( std::max)( u.max_used, used);
+        u.total_used += used;
+    }
+
+    stack_usage find( std::type_info const& ti) {
+        std::unique_lock< std::mutex > lk{ mtx_ };
+        auto i = usage_.find( std::type_index{ ti } );
+        if ( usage_.end() == i) {
+            stack_usage u;
+            u.function = boost::core::demangle( ti.name() );
+            return u;
+        }
+        return i->second;
+    }
+
+    std::vector< stack_usage > report() {
+        std::unique_lock< std::mutex > lk{ mtx_ };
+        std::vector< stack_usage > r;
+        r.reserve( usage_.size() );
+        for ( auto const& e : usage_) {
+            r.push_back( e.second);
+        }
+        return r;
+    }
+
+    void reset() {
+        std::unique_lock< std::mutex > lk{ mtx_ };
+        usage_.clear();
+    }
+
+private:
+    std::mutex                                          mtx_{};
+    std::unordered_map< std::type_index, stack_usage >  usage_{};
+};
+
+constexpr std::uint64_t stack_paint_pattern = 0xfeedfacecafebeefull;
+
+// The lowest page is skipped: protected stacks keep their guard page there.
+inline
+std::uintptr_t painted_bottom( boost::context::stack_context const& sctx) noexcept {
+    return reinterpret_cast< std::uintptr_t >( sctx.sp) - sctx.size
+        + boost::context::stack_traits::page_size();
+}
+
+// fills the stack below top (the frame at the top of the stack) with the pattern
+inline
+void paint_stack( boost::context::stack_context const& sctx, void * top) noexcept {
+    std::uintptr_t bottom = painted_bottom( sctx);
+    std::uintptr_t end = reinterpret_cast< std::uintptr_t >( top) & ~ static_cast< std::uintptr_t >( 7);
+    for ( std::uintptr_t p = bottom; p < end; p += sizeof( stack_paint_pattern) ) {
+        std::memcpy( reinterpret_cast< void * >( p), & stack_paint_pattern, sizeof( stack_paint_pattern) );
+    }
+}
+
+// bytes between the top of the stack and the deepest byte that was written
+inline
+std::size_t painted_usage( boost::context::stack_context const& sctx) noexcept {
+    std::uintptr_t top = reinterpret_cast< std::uintptr_t >( sctx.sp);
+    std::uintptr_t p = painted_bottom( sctx);
+    for ( ; p < top; p += sizeof( stack_paint_pattern) ) {
+        std::uint64_t word;
+        std::memcpy( & word, reinterpret_cast< void const* >( p), sizeof( word) );
+        if ( stack_paint_pattern != word) {
+            break;
+        }
+    }
+    // touching the lowest painted word means the fiber may have used the
+    // unpainted page below it as well
+    if ( painted_bottom( sctx) == p) {
+        return sctx.size;
+    }
+    return top - p;
+}
+
+}
+
+// high-water marks of the fibers whose function is of type Function
+template< typename Function >
+stack_usage stack_usage_of() {
+    return detail::stack_usage_registry::instance().find( typeid( typename std::decay< Function >::type) );
+}
+
+// high-water marks of all fiber functions measured so far
+inline
+std::vector< stack_usage > stack_usage_report() {
+    return detail::stack_usage_registry::instance().report();
+}
+
+inline
+void reset_stack_usage() {
+    detail::stack_usage_registry::instance().reset();
+}
+
+}}
+
+#endif // BOOST_SPAWN_STACK_USAGE_H
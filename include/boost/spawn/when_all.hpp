@@ -0,0 +1,92 @@
+//          Copyright Oliver Kowalke 2021.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef BOOST_SPAWN_WHEN_ALL_H
+#define BOOST_SPAWN_WHEN_ALL_H
+
+#include <cstddef>
+#include <tuple>
+#include <utility>
+
+#include <boost/optional.hpp>
+
+#include <boost/spawn.hpp>
+#include <boost/spawn/cancellation.hpp>
+#include <boost/spawn/detail/operation_group.hpp>
+
+namespace boost {
+namespace spawn {
+namespace detail {
+
+// Resumes the fiber when the last operation has completed. One count per
+// operation and one for the fiber, like fiber_async_result.
+template< typename Policy, std::size_t N >
+class when_all_group {
+public:
+    bool complete( std::size_t) noexcept {
+        return --ready_ == 0;
+    }
+
+    bool initiated( std::size_t started, bool failed) noexcept {
+        if ( failed) {
+            // the fiber rethrows the exception: cancel the operations started
+            signals_.emit();
+        }
+        ready_ -= N - started;
+        return --ready_ != 0;
+    }
+
+    cancellation_slot slot( std::size_t index) noexcept {
+        return signals_.slot( index);
+    }
+
+    void cancel() noexcept {
+        signals_.emit();
+    }
+
+private:
+    typename Policy::counter_type   ready_{ N + 1 };
+    group_signals< N >              signals_{};
+};
+
+template< typename Handler, typename ...Results, typename ...Functions, std::size_t ...Is >
+std::tuple< Results... > when_all( basic_yield_context< Handler > const& yield,
+                                   std::tuple< Results... > *,
+                                   std::index_sequence< Is... > seq,
+                                   Functions && ... functions) {
+    when_all_group< typename concurrency_policy< Handler >::type, sizeof...( Functions) > group;
+    std::tuple< boost::optional< Results >... > slots;
+    run_group( yield, group, slots, seq, std::forward< Functions >( functions)... );
+    return std::tuple< Results... >{ std::move( * std::get< Is >( slots) )... };
+}
+
+}
+
+// Starts several asynchronous operations from one fiber and suspends the
+// fiber once, until all of them have completed. Each function is called, in
+// order, with a completion token and must start exactly one operation with
+// it and return the operation's result, for instance
+//
+//   auto r = when_all( yield,
+//       [&]( auto token) { return s1.async_read_some( b1, token); },
+//       [&]( auto token) { return s2.async_read_some( b2, token); });
+//
+// The result of each operation is a std::tuple of its error_code, followed
+// by the other arguments of its completion handler. Failed operations do not
+// throw; their error_code is returned. The completion handlers run through
+// the executor of the fiber. Cancelling the fiber emits the cancellation
+// slot of each token (see when_any()), as does a function that throws.
+template< typename Handler, typename ...Functions >
+detail::group_result< Functions... >
+when_all( basic_yield_context< Handler > const& yield, Functions && ... functions) {
+    return detail::when_all( yield,
+            static_cast< detail::group_result< Functions... > * >( nullptr),
+            std::index_sequence_for< Functions... >{},
+            std::forward< Functions >( functions)... );
+}
+
+}}
+
+#endif // BOOST_SPAWN_WHEN_ALL_H
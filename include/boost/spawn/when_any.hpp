@@ -0,0 +1,130 @@
+//          Copyright Oliver Kowalke 2021.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef BOOST_SPAWN_WHEN_ANY_H
+#define BOOST_SPAWN_WHEN_ANY_H
+
+#include <cstddef>
+#include <tuple>
+#include <utility>
+
+#include <boost/optional.hpp>
+
+#include <boost/spawn.hpp>
+#include <boost/spawn/cancellation.hpp>
+#include <boost/spawn/detail/operation_group.hpp>
+
+namespace boost {
+namespace spawn {
+namespace detail {
+
+// The first operation to complete wins. Its completion handler cancels the
+// other operations, unless they are still being started: then the fiber
+// cancels them once it has started the last one. The fiber is resumed when
+// all operations have completed, because each of them writes its result
+// into the fiber's frame.
+template< typename Policy, std::size_t N >
+class when_any_group {
+public:
+    bool complete( std::size_t index) noexcept {
+        if ( --first_ == 0) {
+            winner_ = index;
+            if ( --cancel_ == 0) {
+                cancel_losers();
+            }
+        }
+        return --ready_ == 0;
+    }
+
+    bool initiated( std::size_t started, bool failed) noexcept {
+        if ( failed && --first_ == 0) {
+            // nothing has won: cancel every operation started
+            winner_ = N;
+            --cancel_;
+        }
+        ready_ -= N - started;
+        if ( --cancel_ == 0) {
+            cancel_losers();
+        }
+        return --ready_ != 0;
+    }
+
+    cancellation_slot slot( std::size_t index) noexcept {
+        return signals_.slot( index);
+    }
+
+    void cancel() noexcept {
+        signals_.emit();
+    }
+
+    std::size_t winner() const noexcept {
+        return winner_;
+    }
+
+private:
+    typename Policy::counter_type   ready_{ N + 1 };
+    // the first operation to complete decrements this to zero
+    typename Policy::counter_type   first_{ 1 };
+    // zero once there is a winner and all operations have been started
+    typename Policy::counter_type   cancel_{ 2 };
+    std::size_t                     winner_{ N };
+    group_signals< N >              signals_{};
+
+    void cancel_losers() noexcept {
+        signals_.emit( winner_);
+    }
+};
+
+template< typename Handler, typename ...Results, typename ...Functions, std::size_t ...Is >
+std::tuple< std::size_t, Results... > when_any( basic_yield_context< Handler > const& yield,
+                                                std::tuple< Results... > *,
+                                                std::index_sequence< Is... > seq,
+                                                Functions && ... functions) {
+    when_any_group< typename concurrency_policy< Handler >::type, sizeof...( Functions) > group;
+    std::tuple< boost::optional< Results >... > slots;
+    run_group( yield, group, slots, seq, std::forward< Functions >( functions)... );
+    return std::tuple< std::size_t, Results... >{ group.winner(), std::move( * std::get< Is >( slots) )... };
+}
+
+}
+
+// Starts several asynchronous operations from one fiber, like when_all(),
+// and cancels the other operations as soon as the first one has completed.
+// An operation is cancelled through the cancellation_slot of its token, in
+// which the function installs a handler that must not throw, for instance
+//
+//   auto r = when_any( yield,
+//       [&]( auto token) {
+//           token.get_cancellation_slot().assign( [&]{ sock.cancel(); });
+//           return sock.async_read_some( b, token);
+//       },
+//       [&]( auto token) {
+//           token.get_cancellation_slot().assign( [&]{ timer.cancel(); });
+//           return timer.async_wait( token);
+//       });
+//
+// Returns the index of the operation that completed first, followed by the
+// result of each operation, as returned by when_all(). The fiber is resumed
+// once the cancelled operations have completed too, not on the first
+// completion alone: an operation without a cancellation handler, or one that
+// ignores cancellation, delays the return until it completes by itself. No
+// fiber is spawned; the cancellation handlers run in the completion handler
+// of the first operation.
+template< typename Handler, typename ...Functions >
+auto when_any( basic_yield_context< Handler > const& yield, Functions && ... functions)
+    -> decltype( detail::when_any( yield,
+                static_cast< detail::group_result< Functions... > * >( nullptr),
+                std::index_sequence_for< Functions... >{},
+                std::forward< Functions >( functions)... ) ) {
+    static_assert( 0 < sizeof...( Functions), "when_any() requires at least one operation");
+    return detail::when_any( yield,
+            static_cast< detail::group_result< Functions... > * >( nullptr),
+            std::index_sequence_for< Functions... >{},
+            std::forward< Functions >( functions)... );
+}
+
+}}
+
+#endif // BOOST_SPAWN_WHEN_ANY_H
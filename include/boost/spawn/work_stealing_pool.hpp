@@ -0,0 +1,408 @@
+//          Copyright Oliver Kowalke 2021.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef BOOST_SPAWN_WORK_STEALING_POOL_H
+#define BOOST_SPAWN_WORK_STEALING_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <boost/asio/execution_context.hpp>
+#include <boost/config.hpp>
+
+#include <boost/spawn/detail/wait_queue.hpp>
+
+namespace boost {
+namespace spawn {
+namespace detail {
+
+// Function queued in a work_stealing_pool
+class pool_task {
+public:
+    pool_task   *   next_{ nullptr };
+
+    // runs the function, or only destroys it if invoke is false
+    void complete( bool invoke) {
+        fn_( this, invoke);
+    }
+
+protected:
+    using fn_type = void (*)( pool_task *, bool);
+
+    explicit pool_task( fn_type fn) noexcept :
+        fn_{ fn } {
+    }
+
+    ~pool_task() = default;
+
+private:
+    fn_type     fn_;
+};
+
+// Allocated with the allocator passed to post(); released before the
+// function runs, so that the function can reuse the memory.
+template< typename Function, typename Allocator >
+class pool_task_op final : public pool_task {
+public:
+    template< typename Fn >
+    static pool_task * create( Fn && fn, Allocator const& a) {
+        alloc_type alloc{ a };
+        pool_task_op * p = std::allocator_traits< alloc_type >::allocate( alloc, 1);
+        try {
+            return ::new ( static_cast< void * >( p) ) pool_task_op{ std::forward< Fn >( fn), a };
+        } catch (...) {
+            std::allocator_traits< alloc_type >::deallocate( alloc, p, 1);
+            throw;
+        }
+    }
+
+private:
+    using alloc_type = typename std::allocator_traits< Allocator >::template rebind_alloc< pool_task_op >;
+
+    Function    fn_;
+    Allocator   alloc_;
+
+    template< typename Fn >
+    pool_task_op( Fn && fn, Allocator const& a) :
+        pool_task{ & do_complete },
+        fn_{ std::forward< Fn >( fn) },
+        alloc_{ a } {
+    }
+
+    static void do_complete( pool_task * base, bool invoke) {
+        pool_task_op * p = static_cast< pool_task_op * >( base);
+        alloc_type alloc{ p->alloc_ };
+        Function fn{ std::move( p->fn_) };
+        p->~pool_task_op();
+        std::allocator_traits< alloc_type >::deallocate( alloc, p, 1);
+        if ( invoke) {
+            fn();
+        }
+    }
+};
+
+// Run queue of one thread of a work_stealing_pool. The owning thread takes
+// tasks from the front; an idle thread steals half of the queue.
+class pool_queue {
+public:
+    void push( pool_task * t) noexcept {
+        std::unique_lock< spinlock > lk{ splk_ };
+        append( t, t, 1);
+    }
+
+    pool_task * pop() noexcept {
+        std::unique_lock< spinlock > lk{ splk_ };
+        pool_task * t = head_;
+        if ( nullptr != t) {
+            head_ = t->next_;
+            if ( nullptr == head_) {
+                tail_ = nullptr;
+            }
+            t->next_ = nullptr;
+            --size_;
+        }
+        return t;
+    }
+
+    // moves half of victim's tasks to this queue and returns the first of
+    // them, or nullptr if victim is empty
+    pool_task * steal_from( pool_queue & victim) noexcept {
+        pool_task * head;
+        pool_task * tail;
+        std::size_t n;
+        {
+            std::unique_lock< spinlock > lk{ victim.splk_ };
+            n = ( victim.size_ + 1) / 2;
+            if ( 0 == n) {
+                return nullptr;
+            }
+            head = victim.head_;
+            tail = head;
+            for ( std::size_t i = 1; i < n; ++i) {
+                tail = tail->next_;
+            }
+            victim.head_ = tail->next_;
+            if ( nullptr == victim.head_) {
+                victim.tail_ = nullptr;
+            }
+            victim.size_ -= n;
+        }
+        tail->next_ = nullptr;
+        pool_task * t = head;
+        if ( 1 < n) {
+            std::unique_lock< spinlock > lk{ splk_ };
+            append( head->next_, tail, n - 1);
+        }
+        t->next_ = nullptr;
+        return t;
+    }
+
+private:
+    spinlock            splk_{};
+    pool_task       *   head_{ nullptr };
+    pool_task       *   tail_{ nullptr };
+    std::size_t         size_{ 0 };
+
+    // lock held
+    void append( pool_task * head, pool_task * tail, std::size_t n) noexcept {
+        tail->next_ = nullptr;
+        if ( nullptr == tail_) {
+            head_ = head;
+        } else {
+            tail_->next_ = head;
+        }
+        tail_ = tail;
+        size_ += n;
+    }
+};
+
+}
+
+// Execution context running handlers on a pool of threads. Each thread has
+// its own run queue; handlers posted from a thread of the pool go to that
+// thread's queue, others are distributed round robin. A thread that runs out
+// of work steals half of the queue of another thread before it goes to sleep.
+//
+// Fibers spawned on the pool's executor get a strand each (spawn_fiber()
+// wraps executors in a strand), so they do not share a thread: a fiber is
+// resumed by whichever thread runs its handler and migrates between threads
+// at its suspension points. Fibers sharing a strand run one at a time.
+//
+// Like asio::thread_pool, the threads keep running until join() is called
+// and the pool has run out of work, or until stop() is called.
+class work_stealing_pool : public boost::asio::execution_context {
+public:
+    class executor_type;
+
+    explicit work_stealing_pool( std::size_t threads = default_threads() ) :
+        queues_( std::max< std::size_t >( 1, threads) ) {
+        threads_.reserve( queues_.size() );
+        try {
+            for ( std::size_t i = 0; i < queues_.size(); ++i) {
+                threads_.emplace_back( [this,i] { run( i); });
+            }
+        } catch (...) {
+            stop();
+            join();
+            throw;
+        }
+    }
+
+    work_stealing_pool( work_stealing_pool const&) = delete;
+    work_stealing_pool & operator=( work_stealing_pool const&) = delete;
+
+    // handlers left in the queues are destroyed without being run
+    ~work_stealing_pool() {
+        stop();
+        join();
+        drain();
+        // the services are shut down and destroyed while the queues still
+        // exist; handlers destroyed by a service may post to the pool
+        shutdown();
+        drain();
+        destroy();
+    }
+
+    executor_type get_executor() noexcept;
+
+    // the threads exit as soon as they have finished their current handler
+    void stop() {
+        std::unique_lock< std::mutex > lk{ mtx_ };
+        stopped_.store( true, std::memory_order_release);
+        cnd_.notify_all();
+    }
+
+    // waits for the threads to exit
+    void join() {
+        if ( ! joined_.exchange( true) ) {
+            work_finished();
+        }
+        for ( std::thread & t : threads_) {
+            if ( t.joinable() ) {
+                t.join();
+            }
+        }
+    }
+
+    static std::size_t default_threads() noexcept {
+        return std::max< unsigned int >( 1, std::thread::hardware_concurrency() );
+    }
+
+private:
+    struct thread_info {
+        work_stealing_pool  *   pool;
+        std::size_t             index;
+    };
+
+    std::vector< detail::pool_queue >   queues_;
+    std::vector< std::thread >          threads_{};
+    // queued handlers and work guards; one for the pool until join()
+    std::atomic< std::size_t >          outstanding_{ 1 };
+    std::atomic< std::size_t >          pending_{ 0 };
+    std::atomic< std::size_t >          idle_{ 0 };
+    std::atomic< std::size_t >          next_{ 0 };
+    std::atomic< bool >                 stopped_{ false };
+    std::atomic< bool >                 joined_{ false };
+    std::mutex                          mtx_{};
+    std::condition_variable             cnd_{};
+
+    // Thread of a pool running on the calling thread, if any. Not inlined:
+    // a fiber reading it may be resumed on another thread.
+    BOOST_NOINLINE static
+    thread_info *& current() noexcept {
+        static thread_local thread_info * info = nullptr;
+        return info;
+    }
+
+    bool running_in_this_thread() const noexcept {
+        thread_info * info = current();
+        return nullptr != info && this == info->pool;
+    }
+
+    void work_started() noexcept {
+        outstanding_.fetch_add( 1, std::memory_order_relaxed);
+    }
+
+    void work_finished() {
+        if ( 1 == outstanding_.fetch_sub( 1, std::memory_order_acq_rel) ) {
+            stop();
+        }
+    }
+
+    void post( detail::pool_task * t) noexcept {
+        work_started();
+        thread_info * info = current();
+        const std::size_t i = nullptr != info && this == info->pool
+            ? info->index
+            : next_.fetch_add( 1, std::memory_order_relaxed) % queues_.size();
+        queues_[ i].push( t);
+        // pairs with the check of pending_ in run(): either the sleeping
+        // thread sees the task or this thread sees the sleeper
+        pending_.fetch_add( 1);
+        if ( 0 < idle_.load() ) {
+            std::unique_lock< std::mutex > lk{ mtx_ };
+            cnd_.notify_one();
+        }
+    }
+
+    detail::pool_task * next_task( std::size_t index) noexcept {
+        detail::pool_task * t = queues_[ index].pop();
+        for ( std::size_t i = 1; nullptr == t && i < queues_.size(); ++i) {
+            t = queues_[ index].steal_from( queues_[ ( index + i) % queues_.size()]);
+        }
+        return t;
+    }
+
+    // destroys the queued handlers without running them; destroying a
+    // handler may unwind a fiber, which may post again
+    void drain() {
+        for ( bool found = true; found; ) {
+            found = false;
+            for ( detail::pool_queue & q : queues_) {
+                while ( detail::pool_task * t = q.pop() ) {
+                    found = true;
+                    t->complete( false);
+                }
+            }
+        }
+    }
+
+    void run( std::size_t index) {
+        thread_info info{ this, index };
+        current() = & info;
+        while ( ! stopped_.load( std::memory_order_acquire) ) {
+            detail::pool_task * t = next_task( index);
+            if ( nullptr != t) {
+                pending_.fetch_sub( 1, std::memory_order_relaxed);
+                t->complete( true);
+                work_finished();
+                continue;
+            }
+            std::unique_lock< std::mutex > lk{ mtx_ };
+            idle_.fetch_add( 1);
+            cnd_.wait( lk, [this] {
+                return 0 < pending_.load() || stopped_.load( std::memory_order_relaxed);
+            });
+            idle_.fetch_sub( 1);
+        }
+        current() = nullptr;
+    }
+};
+
+// Executor of a work_stealing_pool
+class work_stealing_pool::executor_type {
+public:
+    work_stealing_pool & context() const noexcept {
+        return * pool_;
+    }
+
+    void on_work_started() const noexcept {
+        pool_->work_started();
+    }
+
+    void on_work_finished() const noexcept {
+        pool_->work_finished();
+    }
+
+    // runs f immediately if called from a thread of the pool
+    template< typename Function, typename Allocator >
+    void dispatch( Function && f, Allocator const& a) const {
+        if ( running_in_this_thread() ) {
+            typename std::decay< Function >::type tmp{ std::forward< Function >( f) };
+            tmp();
+            return;
+        }
+        post( std::forward< Function >( f), a);
+    }
+
+    template< typename Function, typename Allocator >
+    void post( Function && f, Allocator const& a) const {
+        pool_->post( detail::pool_task_op< typename std::decay< Function >::type, Allocator >::create(
+                    std::forward< Function >( f), a) );
+    }
+
+    template< typename Function, typename Allocator >
+    void defer( Function && f, Allocator const& a) const {
+        post( std::forward< Function >( f), a);
+    }
+
+    bool running_in_this_thread() const noexcept {
+        return pool_->running_in_this_thread();
+    }
+
+    friend bool operator==( executor_type const& l, executor_type const& r) noexcept {
+        return l.pool_ == r.pool_;
+    }
+
+    friend bool operator!=( executor_type const& l, executor_type const& r) noexcept {
+        return l.pool_ != r.pool_;
+    }
+
+private:
+    friend class work_stealing_pool;
+
+    explicit executor_type( work_stealing_pool & pool) noexcept :
+        pool_{ & pool } {
+    }
+
+    work_stealing_pool  *   pool_;
+};
+
+inline
+work_stealing_pool::executor_type work_stealing_pool::get_executor() noexcept {
+    return executor_type{ * this };
+}
+
+}}
+
+#endif // BOOST_SPAWN_WORK_STEALING_POOL_H
@@ -0,0 +1,43 @@
+//          Copyright Oliver Kowalke 2021.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+#include <boost/assert.hpp>
+
+typedef std::chrono::steady_clock   clock_type;
+typedef clock_type::duration        duration_type;
+typedef clock_type::time_point      time_point_type;
+
+struct clock_overhead {
+    std::uint64_t operator()() {
+        time_point_type start( clock_type::now() );
+        return ( clock_type::now() - start).count();
+    }
+};
+
+inline
+duration_type overhead_clock() {
+    std::size_t iterations( 10);
+    std::vector< std::uint64_t >  overhead( iterations, 0);
+    for ( std::size_t i = 0; i < iterations; ++i) {
+        std::generate(
+            overhead.begin(), overhead.end(),
+            clock_overhead() );
+    }
+    BOOST_ASSERT( overhead.begin() != overhead.end() );
+    std::uint64_t sum = std::accumulate( overhead.begin(), overhead.end(), std::uint64_t{ 0 });
+    return duration_type( sum / overhead.size() );
+}
+
+#endif // CLOCK_H
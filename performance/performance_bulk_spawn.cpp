@@ -0,0 +1,122 @@
+//          Copyright Oliver Kowalke 2021.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// Startup burst: a thread outside the io_context spawns many fibers, each
+// of which suspends once and returns. Reported per fiber:
+// - spawn: time spent in the spawning thread
+// - total: time until the io_context has run all fibers to completion
+// for a loop of spawn_fiber() calls and for one spawn_fibers() call.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/program_options.hpp>
+
+#include <boost/spawn.hpp>
+#include <boost/spawn/bulk_spawn.hpp>
+#include <boost/spawn/pooled_stack.hpp>
+
+#include "clock.hpp"
+
+std::uint64_t fibers = 10000;
+std::size_t stack_size = 64 * 1024;
+
+struct fiber_fn {
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        boost::asio::post( yield);
+    }
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield, std::size_t) {
+        boost::asio::post( yield);
+    }
+};
+
+struct result {
+    duration_type   spawn;
+    duration_type   total;
+};
+
+template< typename StackAllocator >
+result measure_loop( StackAllocator const& salloc) {
+    boost::asio::io_context ioc{ 1 };
+    time_point_type start( clock_type::now() );
+    for ( std::uint64_t i = 0; i < fibers; ++i) {
+        boost::spawn_fiber( ioc, fiber_fn{}, salloc);
+    }
+    duration_type spawn = clock_type::now() - start;
+    ioc.run();
+    return result{ spawn, clock_type::now() - start };
+}
+
+template< typename StackAllocator >
+result measure_bulk( StackAllocator const& salloc) {
+    boost::asio::io_context ioc{ 1 };
+    time_point_type start( clock_type::now() );
+    boost::spawn_fibers( ioc, fibers, fiber_fn{}, salloc);
+    duration_type spawn = clock_type::now() - start;
+    ioc.run();
+    return result{ spawn, clock_type::now() - start };
+}
+
+void report( char const* name, char const* salloc, result r) {
+    std::cout << name << ", " << salloc << ": spawn "
+              << std::chrono::duration_cast< std::chrono::nanoseconds >( r.spawn).count() / fibers
+              << " ns/fiber, total "
+              << std::chrono::duration_cast< std::chrono::nanoseconds >( r.total).count() / fibers
+              << " ns/fiber" << std::endl;
+}
+
+template< typename StackAllocator >
+void run( char const* salloc_name, StackAllocator const& salloc) {
+    // warm-up, fills the pool of pooled_stack
+    measure_loop( salloc);
+    report( "spawn_fiber loop", salloc_name, measure_loop( salloc) );
+    report( "spawn_fibers", salloc_name, measure_bulk( salloc) );
+}
+
+int main( int argc, char * argv[]) {
+    try {
+        boost::program_options::options_description desc("allowed options");
+        desc.add_options()
+            ("help", "help message")
+            ("fibers,f", boost::program_options::value< std::uint64_t >( & fibers), "fibers in the burst")
+            ("stack-size,s", boost::program_options::value< std::size_t >( & stack_size), "stack size in bytes");
+
+        boost::program_options::variables_map vm;
+        boost::program_options::store(
+                boost::program_options::parse_command_line(
+                    argc,
+                    argv,
+                    desc),
+                vm);
+        boost::program_options::notify( vm);
+
+        if ( vm.count("help") ) {
+            std::cout << desc << std::endl;
+            return EXIT_SUCCESS;
+        }
+        if ( 0 == fibers) {
+            throw std::invalid_argument{ "fibers must not be zero" };
+        }
+
+        run( "fixedsize_stack", boost::context::fixedsize_stack{ stack_size } );
+        run( "pooled_stack", boost::spawn::pooled_stack{ stack_size, fibers, fibers } );
+
+        return EXIT_SUCCESS;
+    } catch ( std::exception const& e) {
+        std::cerr << "exception: " << e.what() << std::endl;
+    } catch (...) {
+        std::cerr << "unhandled exception" << std::endl;
+    }
+    return EXIT_FAILURE;
+}
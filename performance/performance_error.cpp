@@ -0,0 +1,144 @@
+//          Copyright Oliver Kowalke 2021.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// Cost of an asynchronous operation that fails with eof, by the way the
+// error is delivered to the fiber:
+// - throw:      system_error thrown by the yield context and caught
+// - error_code: yield[ec]
+// - as_result:  yield.as_result()
+// The completion handler runs before async_result::get(), so the fiber is
+// not suspended; the difference between the modes is the error path alone.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/program_options.hpp>
+
+#include <boost/spawn.hpp>
+
+#include "clock.hpp"
+
+std::uint64_t jobs = 1000000;
+
+template< typename CompletionToken >
+auto async_fail( CompletionToken && token)
+    -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken, void( boost::system::error_code, std::size_t) ) {
+    boost::asio::async_completion< CompletionToken, void( boost::system::error_code, std::size_t) > init{ token };
+    init.completion_handler( boost::asio::error::eof, 0);
+    return init.result.get();
+}
+
+struct throw_fn {
+    duration_type & result;
+    std::size_t &   failed;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        time_point_type start( clock_type::now() );
+        for ( std::size_t i = 0; i < jobs; ++i) {
+            try {
+                async_fail( yield);
+            } catch ( boost::system::system_error const&) {
+                ++failed;
+            }
+        }
+        result = clock_type::now() - start;
+    }
+};
+
+struct error_code_fn {
+    duration_type & result;
+    std::size_t &   failed;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        boost::system::error_code ec;
+        time_point_type start( clock_type::now() );
+        for ( std::size_t i = 0; i < jobs; ++i) {
+            async_fail( yield[ec]);
+            if ( ec) {
+                ++failed;
+            }
+        }
+        result = clock_type::now() - start;
+    }
+};
+
+struct as_result_fn {
+    duration_type & result;
+    std::size_t &   failed;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        time_point_type start( clock_type::now() );
+        for ( std::size_t i = 0; i < jobs; ++i) {
+            if ( ! async_fail( yield.as_result() ) ) {
+                ++failed;
+            }
+        }
+        result = clock_type::now() - start;
+    }
+};
+
+template< typename Fn >
+duration_type measure_time() {
+    boost::asio::io_context ioc{ 1 };
+    duration_type total{ 0 };
+    std::size_t failed = 0;
+    boost::spawn_fiber( ioc, Fn{ total, failed } );
+    ioc.run();
+    if ( jobs != failed) {
+        throw std::logic_error{ "an operation did not fail" };
+    }
+    total -= overhead_clock(); // overhead of measurement
+    total /= jobs;  // loops
+    return total;
+}
+
+int main( int argc, char * argv[]) {
+    try {
+        boost::program_options::options_description desc("allowed options");
+        desc.add_options()
+            ("help", "help message")
+            ("jobs,j", boost::program_options::value< std::uint64_t >( & jobs), "jobs to run");
+
+        boost::program_options::variables_map vm;
+        boost::program_options::store(
+                boost::program_options::parse_command_line(
+                    argc,
+                    argv,
+                    desc),
+                vm);
+        boost::program_options::notify( vm);
+
+        if ( vm.count("help") ) {
+            std::cout << desc << std::endl;
+            return EXIT_SUCCESS;
+        }
+        if ( 0 == jobs) {
+            throw std::invalid_argument{ "jobs must not be zero" };
+        }
+
+        std::uint64_t res = measure_time< throw_fn >().count();
+        std::cout << "failed operation, throw: average of " << res << " nano seconds" << std::endl;
+        res = measure_time< error_code_fn >().count();
+        std::cout << "failed operation, error_code: average of " << res << " nano seconds" << std::endl;
+        res = measure_time< as_result_fn >().count();
+        std::cout << "failed operation, as_result: average of " << res << " nano seconds" << std::endl;
+
+        return EXIT_SUCCESS;
+    } catch ( std::exception const& e) {
+        std::cerr << "exception: " << e.what() << std::endl;
+    } catch (...) {
+        std::cerr << "unhandled exception" << std::endl;
+    }
+    return EXIT_FAILURE;
+}
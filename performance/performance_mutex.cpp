@@ -0,0 +1,177 @@
+//          Copyright Oliver Kowalke 2021.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// Cost of lock() plus unlock(), boost::spawn::mutex against std::mutex:
+// - uncontended: one fiber locking in a loop
+// - contended:   --fibers fibers on an io_context run by --threads threads,
+//                each locking in a loop and yielding through post() after
+//                every unlock; a std::mutex blocks the whole thread while
+//                it waits, a boost::spawn::mutex only the fiber
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/program_options.hpp>
+
+#include <boost/spawn.hpp>
+#include <boost/spawn/mutex.hpp>
+
+#include "clock.hpp"
+
+std::uint64_t jobs = 1000000;
+unsigned int threads = 4;
+unsigned int fibers = 64;
+
+struct spawn_mutex {
+    boost::spawn::mutex     mtx{};
+
+    template< typename T >
+    void lock( boost::spawn::basic_yield_context< T > const& yield) {
+        mtx.lock( yield);
+    }
+
+    void unlock() {
+        mtx.unlock();
+    }
+};
+
+struct std_mutex {
+    std::mutex              mtx{};
+
+    template< typename T >
+    void lock( boost::spawn::basic_yield_context< T > const&) {
+        mtx.lock();
+    }
+
+    void unlock() {
+        mtx.unlock();
+    }
+};
+
+template< typename Mutex >
+struct uncontended_fn {
+    Mutex &             mtx;
+    duration_type &     result;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        // cache warm-up
+        mtx.lock( yield);
+        mtx.unlock();
+
+        time_point_type start( clock_type::now() );
+        for ( std::size_t i = 0; i < jobs; ++i) {
+            mtx.lock( yield);
+            mtx.unlock();
+        }
+        result = clock_type::now() - start;
+    }
+};
+
+template< typename Mutex >
+struct contended_fn {
+    Mutex &             mtx;
+    std::uint64_t &     counter;
+    std::uint64_t       n;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        for ( std::uint64_t i = 0; i < n; ++i) {
+            mtx.lock( yield);
+            ++counter;
+            mtx.unlock();
+            boost::asio::post( yield);
+        }
+    }
+};
+
+template< typename Mutex >
+duration_type measure_uncontended() {
+    Mutex mtx;
+    boost::asio::io_context ioc{ 1 };
+    duration_type total{ 0 };
+    boost::spawn_fiber( ioc, uncontended_fn< Mutex >{ mtx, total } );
+    // glibc's std::mutex skips atomic operations as long as the process
+    // has a single thread
+    std::thread t{ [&ioc] { ioc.run(); } };
+    t.join();
+    total -= overhead_clock(); // overhead of measurement
+    total /= jobs;  // loops
+    return total;
+}
+
+template< typename Mutex >
+duration_type measure_contended() {
+    Mutex mtx;
+    std::uint64_t counter = 0;
+    std::uint64_t n = jobs / fibers;
+    boost::asio::io_context ioc{ static_cast< int >( threads) };
+    for ( unsigned int i = 0; i < fibers; ++i) {
+        boost::spawn_fiber( ioc, contended_fn< Mutex >{ mtx, counter, n } );
+    }
+    time_point_type start( clock_type::now() );
+    std::vector< std::thread > workers;
+    for ( unsigned int i = 0; i < threads; ++i) {
+        workers.emplace_back( [&ioc] { ioc.run(); });
+    }
+    for ( std::thread & t : workers) {
+        t.join();
+    }
+    duration_type total = clock_type::now() - start;
+    if ( counter != n * fibers) {
+        throw std::runtime_error{ "lost update" };
+    }
+    total /= n * fibers;
+    return total;
+}
+
+int main( int argc, char * argv[]) {
+    try {
+        boost::program_options::options_description desc("allowed options");
+        desc.add_options()
+            ("help", "help message")
+            ("jobs,j", boost::program_options::value< std::uint64_t >( & jobs), "jobs to run")
+            ("threads,t", boost::program_options::value< unsigned int >( & threads), "threads running the io_context")
+            ("fibers,f", boost::program_options::value< unsigned int >( & fibers), "fibers competing for the mutex");
+
+        boost::program_options::variables_map vm;
+        boost::program_options::store(
+                boost::program_options::parse_command_line(
+                    argc,
+                    argv,
+                    desc),
+                vm);
+        boost::program_options::notify( vm);
+
+        if ( vm.count("help") ) {
+            std::cout << desc << std::endl;
+            return EXIT_SUCCESS;
+        }
+
+        std::uint64_t res = measure_uncontended< spawn_mutex >().count();
+        std::cout << "uncontended, boost::spawn::mutex: average of " << res << " nano seconds" << std::endl;
+        res = measure_uncontended< std_mutex >().count();
+        std::cout << "uncontended, std::mutex: average of " << res << " nano seconds" << std::endl;
+        res = measure_contended< spawn_mutex >().count();
+        std::cout << "contended, boost::spawn::mutex: average of " << res << " nano seconds" << std::endl;
+        res = measure_contended< std_mutex >().count();
+        std::cout << "contended, std::mutex: average of " << res << " nano seconds" << std::endl;
+
+        return EXIT_SUCCESS;
+    } catch ( std::exception const& e) {
+        std::cerr << "exception: " << e.what() << std::endl;
+    } catch (...) {
+        std::cerr << "unhandled exception" << std::endl;
+    }
+    return EXIT_FAILURE;
+}
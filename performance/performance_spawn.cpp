@@ -0,0 +1,390 @@
+//          Copyright Oliver Kowalke 2021.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// Microbenchmark suite, run for every spawn_fiber() overload and stack
+// allocator:
+// - spawn:             spawn a fiber that returns immediately (runs inline)
+// - switch:            suspend plus resume by invoking the completion handler
+//                      directly, without a scheduler in between
+// - yield_post:        round-trip through post()
+// - yield_timer:       round-trip through an expired steady_timer
+// - throw_after_yield: a fiber that yields and then throws; the exception
+//                      leaves io_context::run(), includes spawning a parent
+//
+// Results are written as CSV, one row per measurement:
+//   benchmark,overload,stack_allocator,iterations,ns_per_op
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/context/fixedsize_stack.hpp>
+#include <boost/context/protected_fixedsize_stack.hpp>
+#include <boost/optional.hpp>
+#include <boost/program_options.hpp>
+
+#include <boost/spawn.hpp>
+#include <boost/spawn/pooled_stack.hpp>
+
+#include "clock.hpp"
+
+std::uint64_t jobs = 100000;
+std::size_t stack_size = 64 * 1024;
+std::string filter;
+
+// spawn_fiber() overloads; yield is the context of the fiber the new
+// fiber is spawned from
+struct io_context_launch {
+    static char const* name() {
+        return "io_context";
+    }
+
+    template< typename Yield, typename Fn, typename StackAllocator >
+    void operator()( boost::asio::io_context & ioc, Yield, Fn && fn, StackAllocator const& salloc) const {
+        boost::spawn_fiber( ioc, std::forward< Fn >( fn), salloc);
+    }
+};
+
+struct executor_launch {
+    static char const* name() {
+        return "executor";
+    }
+
+    template< typename Yield, typename Fn, typename StackAllocator >
+    void operator()( boost::asio::io_context & ioc, Yield, Fn && fn, StackAllocator const& salloc) const {
+        boost::spawn_fiber( ioc.get_executor(), std::forward< Fn >( fn), salloc);
+    }
+};
+
+struct strand_launch {
+    static char const* name() {
+        return "strand";
+    }
+
+    template< typename Yield, typename Fn, typename StackAllocator >
+    void operator()( boost::asio::io_context & ioc, Yield, Fn && fn, StackAllocator const& salloc) const {
+        boost::spawn_fiber( boost::asio::make_strand( ioc), std::forward< Fn >( fn), salloc);
+    }
+};
+
+struct yield_context_launch {
+    static char const* name() {
+        return "yield_context";
+    }
+
+    template< typename Yield, typename Fn, typename StackAllocator >
+    void operator()( boost::asio::io_context &, Yield yield, Fn && fn, StackAllocator const& salloc) const {
+        boost::spawn_fiber( yield, std::forward< Fn >( fn), salloc);
+    }
+};
+
+struct single_threaded_launch {
+    static char const* name() {
+        return "single_threaded";
+    }
+
+    template< typename Yield, typename Fn, typename StackAllocator >
+    void operator()( boost::asio::io_context & ioc, Yield, Fn && fn, StackAllocator const& salloc) const {
+        boost::spawn_fiber( boost::spawn::single_threaded{}, ioc, std::forward< Fn >( fn), salloc);
+    }
+};
+
+// asynchronous operation that hands its completion handler to the caller
+// of the fiber; parking::resume() invokes it
+struct parking {
+    void ( * resume)() = nullptr;
+};
+
+template< typename Handler >
+boost::optional< Handler > & parked() {
+    static thread_local boost::optional< Handler > handler;
+    return handler;
+}
+
+template< typename Handler >
+void resume_parked() {
+    Handler handler{ std::move( * parked< Handler >() ) };
+    parked< Handler >().reset();
+    handler();
+}
+
+template< typename CompletionToken >
+auto async_park( parking & p, CompletionToken && token) -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken, void() ) {
+    boost::asio::async_completion< CompletionToken, void() > init{ token };
+    using handler_type = typename boost::asio::async_completion< CompletionToken, void() >::completion_handler_type;
+    parked< handler_type >().emplace( std::move( init.completion_handler) );
+    p.resume = & resume_parked< handler_type >;
+    return init.result.get();
+}
+
+struct noop_fn {
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T >) {
+    }
+};
+
+struct switch_fn {
+    parking &       p;
+    duration_type & result;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        // cache warm-up
+        async_park( p, yield);
+
+        time_point_type start( clock_type::now() );
+        for ( std::size_t i = 0; i < jobs; ++i) {
+            async_park( p, yield);
+        }
+        result = clock_type::now() - start;
+    }
+};
+
+struct post_fn {
+    duration_type & result;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        // cache warm-up
+        boost::asio::post( yield);
+
+        time_point_type start( clock_type::now() );
+        for ( std::size_t i = 0; i < jobs; ++i) {
+            boost::asio::post( yield);
+        }
+        result = clock_type::now() - start;
+    }
+};
+
+struct timer_fn {
+    duration_type & result;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        boost::asio::steady_timer timer{ boost::asio::get_associated_executor( yield) };
+        // cache warm-up
+        timer.expires_after( boost::asio::chrono::seconds{ 0 } );
+        timer.async_wait( yield);
+
+        time_point_type start( clock_type::now() );
+        for ( std::size_t i = 0; i < jobs / 10; ++i) {
+            timer.expires_after( boost::asio::chrono::seconds{ 0 } );
+            timer.async_wait( yield);
+        }
+        result = clock_type::now() - start;
+    }
+};
+
+struct throw_fn {
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        boost::asio::post( yield);
+        throw std::runtime_error{ "throw_after_yield" };
+    }
+};
+
+template< typename Launch, typename StackAllocator >
+struct spawn_parent {
+    boost::asio::io_context &   ioc;
+    StackAllocator const&       salloc;
+    duration_type &             result;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        // cache warm-up
+        Launch{}( ioc, yield, noop_fn{}, salloc);
+
+        time_point_type start( clock_type::now() );
+        for ( std::size_t i = 0; i < jobs; ++i) {
+            Launch{}( ioc, yield, noop_fn{}, salloc);
+        }
+        result = clock_type::now() - start;
+    }
+};
+
+template< typename Launch, typename StackAllocator >
+struct switch_parent {
+    boost::asio::io_context &   ioc;
+    StackAllocator const&       salloc;
+    duration_type &             result;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        parking p;
+        Launch{}( ioc, yield, switch_fn{ p, result }, salloc);
+        while ( p.resume) {
+            void ( * resume)() = p.resume;
+            p.resume = nullptr;
+            resume();
+        }
+    }
+};
+
+template< typename Launch, typename StackAllocator, typename Fn >
+struct launch_parent {
+    boost::asio::io_context &   ioc;
+    StackAllocator const&       salloc;
+    Fn                          fn;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        Launch{}( ioc, yield, fn, salloc);
+    }
+};
+
+template< typename Launch, typename StackAllocator, typename Fn >
+launch_parent< Launch, StackAllocator, Fn > make_parent( boost::asio::io_context & ioc, StackAllocator const& salloc, Fn fn) {
+    return launch_parent< Launch, StackAllocator, Fn >{ ioc, salloc, fn };
+}
+
+// runs fn inside a fiber on a fresh io_context
+template< typename Fn >
+void run_in_fiber( boost::asio::io_context & ioc, Fn fn) {
+    boost::spawn_fiber( ioc, fn);
+    ioc.run();
+}
+
+template< typename Launch, typename StackAllocator >
+duration_type measure_spawn( StackAllocator const& salloc) {
+    boost::asio::io_context ioc{ 1 };
+    duration_type total{ 0 };
+    run_in_fiber( ioc, spawn_parent< Launch, StackAllocator >{ ioc, salloc, total } );
+    return total;
+}
+
+template< typename Launch, typename StackAllocator >
+duration_type measure_switch( StackAllocator const& salloc) {
+    boost::asio::io_context ioc{ 1 };
+    duration_type total{ 0 };
+    run_in_fiber( ioc, switch_parent< Launch, StackAllocator >{ ioc, salloc, total } );
+    return total;
+}
+
+template< typename Launch, typename StackAllocator >
+duration_type measure_post( StackAllocator const& salloc) {
+    boost::asio::io_context ioc{ 1 };
+    duration_type total{ 0 };
+    run_in_fiber( ioc, make_parent< Launch >( ioc, salloc, post_fn{ total } ) );
+    return total;
+}
+
+template< typename Launch, typename StackAllocator >
+duration_type measure_timer( StackAllocator const& salloc) {
+    boost::asio::io_context ioc{ 1 };
+    duration_type total{ 0 };
+    run_in_fiber( ioc, make_parent< Launch >( ioc, salloc, timer_fn{ total } ) );
+    return total;
+}
+
+template< typename Launch, typename StackAllocator >
+duration_type measure_throw( StackAllocator const& salloc) {
+    boost::asio::io_context ioc{ 1 };
+    time_point_type start( clock_type::now() );
+    for ( std::size_t i = 0; i < jobs / 10; ++i) {
+        boost::spawn_fiber( ioc, make_parent< Launch >( ioc, salloc, throw_fn{} ) );
+        try {
+            ioc.run();
+        } catch ( std::runtime_error const&) {
+        }
+        ioc.restart();
+    }
+    return clock_type::now() - start;
+}
+
+void report( std::ostream & os, char const* benchmark, char const* overload, char const* salloc,
+             std::uint64_t iterations, duration_type total) {
+    total -= overhead_clock(); // overhead of measurement
+    os << benchmark << ',' << overload << ',' << salloc << ',' << iterations << ','
+       << ( iterations ? total.count() / iterations : 0) << std::endl;
+}
+
+bool selected( char const* benchmark) {
+    return filter.empty() || std::string{ benchmark }.find( filter) != std::string::npos;
+}
+
+template< typename Launch, typename StackAllocator >
+void run_all( std::ostream & os, char const* salloc_name, StackAllocator const& salloc) {
+    if ( selected("spawn") ) {
+        report( os, "spawn", Launch::name(), salloc_name, jobs, measure_spawn< Launch >( salloc) );
+    }
+    if ( selected("switch") ) {
+        report( os, "switch", Launch::name(), salloc_name, jobs, measure_switch< Launch >( salloc) );
+    }
+    if ( selected("yield_post") ) {
+        report( os, "yield_post", Launch::name(), salloc_name, jobs, measure_post< Launch >( salloc) );
+    }
+    if ( selected("yield_timer") ) {
+        report( os, "yield_timer", Launch::name(), salloc_name, jobs / 10, measure_timer< Launch >( salloc) );
+    }
+    if ( selected("throw_after_yield") ) {
+        report( os, "throw_after_yield", Launch::name(), salloc_name, jobs / 10, measure_throw< Launch >( salloc) );
+    }
+}
+
+template< typename StackAllocator >
+void run_launches( std::ostream & os, char const* salloc_name, StackAllocator const& salloc) {
+    run_all< io_context_launch >( os, salloc_name, salloc);
+    run_all< executor_launch >( os, salloc_name, salloc);
+    run_all< strand_launch >( os, salloc_name, salloc);
+    run_all< yield_context_launch >( os, salloc_name, salloc);
+    run_all< single_threaded_launch >( os, salloc_name, salloc);
+}
+
+int main( int argc, char * argv[]) {
+    try {
+        std::string output;
+        boost::program_options::options_description desc("allowed options");
+        desc.add_options()
+            ("help", "help message")
+            ("jobs,j", boost::program_options::value< std::uint64_t >( & jobs), "jobs to run")
+            ("stack-size,s", boost::program_options::value< std::size_t >( & stack_size), "stack size in bytes")
+            ("filter,f", boost::program_options::value< std::string >( & filter), "run benchmarks whose name contains this string")
+            ("output,o", boost::program_options::value< std::string >( & output), "write CSV to this file instead of stdout");
+
+        boost::program_options::variables_map vm;
+        boost::program_options::store(
+                boost::program_options::parse_command_line(
+                    argc,
+                    argv,
+                    desc),
+                vm);
+        boost::program_options::notify( vm);
+
+        if ( vm.count("help") ) {
+            std::cout << desc << std::endl;
+            return EXIT_SUCCESS;
+        }
+
+        std::ofstream file;
+        if ( ! output.empty() ) {
+            file.open( output);
+            if ( ! file) {
+                throw std::runtime_error{ "cannot open " + output };
+            }
+        }
+        std::ostream & os = output.empty() ? std::cout : file;
+
+        os << "benchmark,overload,stack_allocator,iterations,ns_per_op" << std::endl;
+        run_launches( os, "fixedsize_stack", boost::context::fixedsize_stack{ stack_size } );
+        run_launches( os, "protected_fixedsize_stack", boost::context::protected_fixedsize_stack{ stack_size } );
+        run_launches( os, "pooled_stack", boost::spawn::pooled_stack{ stack_size } );
+
+        return EXIT_SUCCESS;
+    } catch ( std::exception const& e) {
+        std::cerr << "exception: " << e.what() << std::endl;
+    } catch (...) {
+        std::cerr << "unhandled exception" << std::endl;
+    }
+    return EXIT_FAILURE;
+}
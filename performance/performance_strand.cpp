@@ -0,0 +1,112 @@
+//          Copyright Oliver Kowalke 2021.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// Cost of one yield round-trip (suspend plus resume) of a fiber running on
+// an io_context driven by a single thread:
+// - strand:      spawn_fiber( ioc, ...), every resume passes the strand
+// - strand-free: spawn_fiber( single_threaded{}, ioc, ...), bound to the
+//                io_context's executor directly
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/program_options.hpp>
+
+#include <boost/spawn.hpp>
+
+#include "clock.hpp"
+
+std::uint64_t jobs = 1000000;
+
+struct post_fn {
+    duration_type & result;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        // cache warm-up
+        boost::asio::post( yield);
+
+        time_point_type start( clock_type::now() );
+        for ( std::size_t i = 0; i < jobs; ++i) {
+            boost::asio::post( yield);
+        }
+        result = clock_type::now() - start;
+    }
+};
+
+struct timer_fn {
+    duration_type & result;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        boost::asio::steady_timer timer{ boost::asio::get_associated_executor( yield) };
+        // cache warm-up
+        timer.expires_after( boost::asio::chrono::seconds{ 0 } );
+        timer.async_wait( yield);
+
+        time_point_type start( clock_type::now() );
+        for ( std::size_t i = 0; i < jobs; ++i) {
+            timer.expires_after( boost::asio::chrono::seconds{ 0 } );
+            timer.async_wait( yield);
+        }
+        result = clock_type::now() - start;
+    }
+};
+
+template< typename Fn, typename ... Tag >
+duration_type measure_time( Tag ... tag) {
+    boost::asio::io_context ioc{ 1 };
+    duration_type total{ 0 };
+    boost::spawn_fiber( tag ..., ioc, Fn{ total } );
+    ioc.run();
+    total -= overhead_clock(); // overhead of measurement
+    total /= jobs;  // loops
+    return total;
+}
+
+int main( int argc, char * argv[]) {
+    try {
+        boost::program_options::options_description desc("allowed options");
+        desc.add_options()
+            ("help", "help message")
+            ("jobs,j", boost::program_options::value< std::uint64_t >( & jobs), "jobs to run");
+
+        boost::program_options::variables_map vm;
+        boost::program_options::store(
+                boost::program_options::parse_command_line(
+                    argc,
+                    argv,
+                    desc),
+                vm);
+        boost::program_options::notify( vm);
+
+        if ( vm.count("help") ) {
+            std::cout << desc << std::endl;
+            return EXIT_SUCCESS;
+        }
+
+        std::uint64_t res = measure_time< post_fn >().count();
+        std::cout << "yield post, strand: average of " << res << " nano seconds" << std::endl;
+        res = measure_time< post_fn >( boost::spawn::single_threaded{} ).count();
+        std::cout << "yield post, strand-free: average of " << res << " nano seconds" << std::endl;
+        res = measure_time< timer_fn >().count();
+        std::cout << "yield timer, strand: average of " << res << " nano seconds" << std::endl;
+        res = measure_time< timer_fn >( boost::spawn::single_threaded{} ).count();
+        std::cout << "yield timer, strand-free: average of " << res << " nano seconds" << std::endl;
+
+        return EXIT_SUCCESS;
+    } catch ( std::exception const& e) {
+        std::cerr << "exception: " << e.what() << std::endl;
+    } catch (...) {
+        std::cerr << "unhandled exception" << std::endl;
+    }
+    return EXIT_FAILURE;
+}
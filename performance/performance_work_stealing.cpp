@@ -0,0 +1,123 @@
+//          Copyright Oliver Kowalke 2021.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// Imbalanced workload: a burst of CPU-heavy fibers is spawned from a single
+// thread. Wall-clock time to finish the burst with 1..threads threads:
+// - pinned:        one io_context per thread, all fibers spawned on the
+//                  first one; the other threads stay idle
+// - work stealing: work_stealing_pool, all fibers spawned from one thread
+//                  of the pool; idle threads steal them
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/program_options.hpp>
+
+#include <boost/spawn.hpp>
+#include <boost/spawn/work_stealing_pool.hpp>
+
+#include "clock.hpp"
+
+std::uint64_t fibers = 256;
+std::uint64_t slices = 100;
+std::uint64_t work = 20000;
+std::uint64_t threads = std::thread::hardware_concurrency();
+
+// keeps the optimizer from removing the busy loop
+std::uint64_t volatile sink = 0;
+
+struct burst_fn {
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        std::uint64_t x = 0;
+        for ( std::uint64_t i = 0; i < slices; ++i) {
+            for ( std::uint64_t j = 0; j < work; ++j) {
+                x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+            }
+            boost::asio::post( yield);
+        }
+        sink = x;
+    }
+};
+
+duration_type measure_pinned( std::size_t n) {
+    std::vector< std::unique_ptr< boost::asio::io_context > > contexts;
+    for ( std::size_t i = 0; i < n; ++i) {
+        contexts.emplace_back( new boost::asio::io_context{ 1 } );
+    }
+    for ( std::uint64_t i = 0; i < fibers; ++i) {
+        boost::spawn_fiber( * contexts.front(), burst_fn{} );
+    }
+    time_point_type start( clock_type::now() );
+    std::vector< std::thread > pool;
+    for ( std::size_t i = 0; i < n; ++i) {
+        pool.emplace_back( [&contexts,i] { contexts[ i]->run(); });
+    }
+    for ( std::thread & t : pool) {
+        t.join();
+    }
+    return clock_type::now() - start;
+}
+
+duration_type measure_work_stealing( std::size_t n) {
+    time_point_type start( clock_type::now() );
+    boost::spawn::work_stealing_pool pool{ n };
+    boost::asio::post( pool.get_executor(), [&pool] {
+        for ( std::uint64_t i = 0; i < fibers; ++i) {
+            boost::spawn_fiber( pool, burst_fn{} );
+        }
+    });
+    pool.join();
+    return clock_type::now() - start;
+}
+
+int main( int argc, char * argv[]) {
+    try {
+        boost::program_options::options_description desc("allowed options");
+        desc.add_options()
+            ("help", "help message")
+            ("fibers,f", boost::program_options::value< std::uint64_t >( & fibers), "fibers in the burst")
+            ("slices,s", boost::program_options::value< std::uint64_t >( & slices), "yields per fiber")
+            ("work,w", boost::program_options::value< std::uint64_t >( & work), "loop iterations between yields")
+            ("threads,t", boost::program_options::value< std::uint64_t >( & threads), "maximum number of threads");
+
+        boost::program_options::variables_map vm;
+        boost::program_options::store(
+                boost::program_options::parse_command_line(
+                    argc,
+                    argv,
+                    desc),
+                vm);
+        boost::program_options::notify( vm);
+
+        if ( vm.count("help") ) {
+            std::cout << desc << std::endl;
+            return EXIT_SUCCESS;
+        }
+
+        for ( std::uint64_t n = 1; n <= std::max< std::uint64_t >( 1, threads); n *= 2) {
+            std::uint64_t res = std::chrono::duration_cast< std::chrono::milliseconds >( measure_pinned( n) ).count();
+            std::cout << n << " threads, pinned: " << res << " ms" << std::endl;
+            res = std::chrono::duration_cast< std::chrono::milliseconds >( measure_work_stealing( n) ).count();
+            std::cout << n << " threads, work stealing: " << res << " ms" << std::endl;
+        }
+
+        return EXIT_SUCCESS;
+    } catch ( std::exception const& e) {
+        std::cerr << "exception: " << e.what() << std::endl;
+    } catch (...) {
+        std::cerr << "unhandled exception" << std::endl;
+    }
+    return EXIT_FAILURE;
+}
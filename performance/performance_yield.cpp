@@ -0,0 +1,138 @@
+//          Copyright Oliver Kowalke 2021.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// Cost of one suspension of a spawned fiber, for both concurrency policies:
+// - inline: the completion handler runs before async_result::get(), so the
+//   fiber is not suspended; measures the handler bookkeeping alone
+// - post:   round-trip through io_context::post(), suspend plus resume
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/program_options.hpp>
+
+#include <boost/spawn.hpp>
+
+#include "clock.hpp"
+
+std::uint64_t jobs = 1000000;
+
+struct multi_threaded_handler {
+    void operator()() {
+    }
+};
+
+struct single_threaded_handler {
+    void operator()() {
+    }
+};
+
+namespace boost {
+namespace spawn {
+
+template< typename Executor >
+struct concurrency_policy< boost::asio::executor_binder< single_threaded_handler, Executor > > {
+    using type = single_threaded;
+};
+
+}}
+
+template< typename CompletionToken >
+auto async_inline( CompletionToken && token) -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken, void() ) {
+    boost::asio::async_completion< CompletionToken, void() > init{ token };
+    init.completion_handler();
+    return init.result.get();
+}
+
+struct inline_fn {
+    duration_type & result;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        // cache warm-up
+        async_inline( yield);
+
+        time_point_type start( clock_type::now() );
+        for ( std::size_t i = 0; i < jobs; ++i) {
+            async_inline( yield);
+        }
+        result = clock_type::now() - start;
+    }
+};
+
+struct post_fn {
+    duration_type & result;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        // cache warm-up
+        boost::asio::post( yield);
+
+        time_point_type start( clock_type::now() );
+        for ( std::size_t i = 0; i < jobs; ++i) {
+            boost::asio::post( yield);
+        }
+        result = clock_type::now() - start;
+    }
+};
+
+template< typename Handler, typename Fn >
+duration_type measure_time() {
+    boost::asio::io_context ioc{ 1 };
+    duration_type total{ 0 };
+    boost::spawn_fiber(
+            boost::asio::bind_executor( ioc.get_executor(), Handler{} ),
+            Fn{ total } );
+    ioc.run();
+    total -= overhead_clock(); // overhead of measurement
+    total /= jobs;  // loops
+    return total;
+}
+
+int main( int argc, char * argv[]) {
+    try {
+        boost::program_options::options_description desc("allowed options");
+        desc.add_options()
+            ("help", "help message")
+            ("jobs,j", boost::program_options::value< std::uint64_t >( & jobs), "jobs to run");
+
+        boost::program_options::variables_map vm;
+        boost::program_options::store(
+                boost::program_options::parse_command_line(
+                    argc,
+                    argv,
+                    desc),
+                vm);
+        boost::program_options::notify( vm);
+
+        if ( vm.count("help") ) {
+            std::cout << desc << std::endl;
+            return EXIT_SUCCESS;
+        }
+
+        std::uint64_t res = measure_time< multi_threaded_handler, inline_fn >().count();
+        std::cout << "yield inline, multi_threaded: average of " << res << " nano seconds" << std::endl;
+        res = measure_time< single_threaded_handler, inline_fn >().count();
+        std::cout << "yield inline, single_threaded: average of " << res << " nano seconds" << std::endl;
+        res = measure_time< multi_threaded_handler, post_fn >().count();
+        std::cout << "yield post, multi_threaded: average of " << res << " nano seconds" << std::endl;
+        res = measure_time< single_threaded_handler, post_fn >().count();
+        std::cout << "yield post, single_threaded: average of " << res << " nano seconds" << std::endl;
+
+        return EXIT_SUCCESS;
+    } catch ( std::exception const& e) {
+        std::cerr << "exception: " << e.what() << std::endl;
+    } catch (...) {
+        std::cerr << "unhandled exception" << std::endl;
+    }
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,256 @@
+//          Copyright Oliver Kowalke 2021.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include <boost/spawn.hpp>
+#include <boost/spawn/channel.hpp>
+#include <boost/spawn/mutex.hpp>
+#include <boost/spawn/semaphore.hpp>
+
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/config.hpp>
+#include <boost/context/fixedsize_stack.hpp>
+#include <boost/test/unit_test.hpp>
+
+// count every call of the global operator new; fixedsize_stack takes its
+// memory from std::malloc, so stack allocations are not counted
+static std::atomic< std::size_t > allocations{ 0 };
+
+void * operator new( std::size_t size) {
+    ++allocations;
+    if ( void * p = std::malloc( size ? size : 1) ) {
+        return p;
+    }
+    throw std::bad_alloc{};
+}
+
+// not inlined into the operators delete: GCC would pair the std::free()
+// with the operator new of the deleted object (-Wmismatched-new-delete)
+BOOST_NOINLINE
+static void release( void * p) noexcept {
+    std::free( p);
+}
+
+void operator delete( void * p) noexcept {
+    release( p);
+}
+
+void operator delete( void * p, std::size_t) noexcept {
+    release( p);
+}
+
+// memory for asio's operation states is taken from a static arena through
+// the handler's associated allocator, so it does not show up as allocations
+static char arena[ 64 * 1024 ];
+static std::size_t arena_used = 0;
+
+template< typename T >
+struct arena_allocator {
+    typedef T value_type;
+
+    arena_allocator() = default;
+
+    template< typename U >
+    arena_allocator( arena_allocator< U > const&) noexcept {
+    }
+
+    T * allocate( std::size_t n) {
+        std::size_t size = ( n * sizeof( T) + 15) & ~std::size_t{ 15 };
+        if ( sizeof( arena) < arena_used + size) {
+            throw std::bad_alloc{};
+        }
+        void * p = arena + arena_used;
+        arena_used += size;
+        return static_cast< T * >( p);
+    }
+
+    void deallocate( T *, std::size_t) noexcept {
+    }
+
+    template< typename U >
+    bool operator==( arena_allocator< U > const&) const noexcept {
+        return true;
+    }
+
+    template< typename U >
+    bool operator!=( arena_allocator< U > const&) const noexcept {
+        return false;
+    }
+};
+
+struct arena_handler {
+    typedef arena_allocator< void > allocator_type;
+
+    int &   count;
+
+    allocator_type get_allocator() const noexcept {
+        return allocator_type{};
+    }
+
+    void operator()() {
+        ++count;
+    }
+};
+
+struct yield_handler {
+    int &   count;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > y) {
+        boost::asio::post( y); // suspend and resume
+        ++count;
+    }
+};
+
+struct spawn_yield_handler {
+    int &   count;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > y) {
+        boost::spawn_fiber( y, yield_handler{ count }, boost::context::fixedsize_stack{ 65536 } );
+        boost::asio::post( y); // suspend and resume
+        ++count;
+    }
+};
+
+struct lock_handler {
+    boost::spawn::mutex &       mtx;
+    boost::spawn::semaphore &   sem;
+    int &                       count;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > y) {
+        std::size_t before = allocations;
+        for ( int i = 0; i < 10; ++i) {
+            mtx.lock( y);
+            sem.acquire( y);
+            ++count;
+            sem.release();
+            mtx.unlock();
+        }
+        BOOST_CHECK_EQUAL(before, allocations.load() );
+    }
+};
+
+struct channel_handler {
+    boost::spawn::channel< int > &  chan;
+    int &                           count;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > y) {
+        std::size_t before = allocations;
+        for ( int i = 0; i < 10; ++i) {
+            chan.send( i, y);
+            chan.send( i, y);
+            count += chan.receive( y) - i;
+            count += chan.receive( y) - i + 1;
+        }
+        BOOST_CHECK_EQUAL(before, allocations.load() );
+    }
+};
+
+void spawnAllocatesOnlyStack() {
+    boost::asio::io_context ioc;
+    int called = 0;
+    std::size_t before = allocations;
+    boost::spawn_fiber(
+            bind_executor( ioc.get_executor(), arena_handler{ called } ),
+            yield_handler{ called },
+            boost::context::fixedsize_stack{ 65536 } );
+    ioc.run();
+    BOOST_CHECK_EQUAL(before, allocations.load() );
+    BOOST_CHECK_EQUAL(2, called);
+}
+
+void spawnNestedAllocatesOnlyStack() {
+    boost::asio::io_context ioc;
+    int called = 0;
+    std::size_t before = allocations;
+    boost::spawn_fiber(
+            bind_executor( ioc.get_executor(), arena_handler{ called } ),
+            spawn_yield_handler{ called },
+            boost::context::fixedsize_stack{ 65536 } );
+    ioc.run();
+    BOOST_CHECK_EQUAL(before, allocations.load() );
+    BOOST_CHECK_EQUAL(3, called);
+}
+
+void uncontendedLockAllocatesNothing() {
+    boost::asio::io_context ioc;
+    boost::spawn::mutex mtx;
+    boost::spawn::semaphore sem{ 1 };
+    int called = 0;
+    boost::spawn_fiber(
+            bind_executor( ioc.get_executor(), arena_handler{ called } ),
+            lock_handler{ mtx, sem, called },
+            boost::context::fixedsize_stack{ 65536 } );
+    ioc.run();
+    BOOST_CHECK_EQUAL(11, called);
+}
+
+void channelWithinCapacityAllocatesNothing() {
+    boost::asio::io_context ioc;
+    boost::spawn::channel< int > chan{ 2 };
+    int called = 0;
+    boost::spawn_fiber(
+            bind_executor( ioc.get_executor(), arena_handler{ called } ),
+            channel_handler{ chan, called },
+            boost::context::fixedsize_stack{ 65536 } );
+    ioc.run();
+    BOOST_CHECK_EQUAL(11, called);
+}
+
+// a timer with the type-erased any_io_executor would allocate to wrap the
+// strand of the completion handler
+using timer_type = boost::asio::basic_waitable_timer<
+    std::chrono::steady_clock,
+    boost::asio::wait_traits< std::chrono::steady_clock >,
+    boost::asio::io_context::executor_type >;
+
+struct timer_handler {
+    int &   count;
+
+    void operator()( boost::spawn::strand_yield_context< boost::asio::io_context::executor_type > y) {
+        timer_type timer{ y.handler_.get_executor().get_inner_executor() };
+        // the first operations populate the fiber's handler memory
+        for ( int i = 0; i < 2; ++i) {
+            timer.expires_after( std::chrono::milliseconds{ 0 } );
+            timer.async_wait( y);
+        }
+        std::size_t before = allocations;
+        for ( int i = 0; i < 10; ++i) {
+            timer.expires_after( std::chrono::milliseconds{ 0 } );
+            timer.async_wait( y);
+            boost::asio::post( y);
+            ++count;
+        }
+        BOOST_CHECK_EQUAL(before, allocations.load() );
+    }
+};
+
+void operationsRecycleMemory() {
+    boost::asio::io_context ioc;
+    int called = 0;
+    boost::spawn_fiber( ioc, timer_handler{ called }, boost::context::fixedsize_stack{ 65536 } );
+    ioc.run();
+    BOOST_CHECK_EQUAL(10, called);
+}
+
+boost::unit_test::test_suite * init_unit_test_suite( int, char* []) {
+    boost::unit_test::test_suite * test =
+        BOOST_TEST_SUITE("Boost.Spawn: allocation test suite");
+    test->add( BOOST_TEST_CASE( & spawnAllocatesOnlyStack) );
+    test->add( BOOST_TEST_CASE( & spawnNestedAllocatesOnlyStack) );
+    test->add( BOOST_TEST_CASE( & uncontendedLockAllocatesNothing) );
+    test->add( BOOST_TEST_CASE( & channelWithinCapacityAllocatesNothing) );
+    test->add( BOOST_TEST_CASE( & operationsRecycleMemory) );
+    return test;
+}
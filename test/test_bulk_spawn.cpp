@@ -0,0 +1,181 @@
+//          Copyright Oliver Kowalke 2021.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+#include <boost/spawn.hpp>
+#include <boost/spawn/bulk_spawn.hpp>
+#include <boost/spawn/pooled_stack.hpp>
+#include <boost/spawn/work_stealing_pool.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/context/fixedsize_stack.hpp>
+#include <boost/test/unit_test.hpp>
+
+struct indexed_handler {
+    std::vector< int > &    counts;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield, std::size_t index) {
+        boost::asio::post( yield);
+        ++counts[ index];
+    }
+};
+
+void spawnIndexed() {
+    std::vector< int > counts( 100, 0);
+    boost::asio::io_context ioc;
+    boost::spawn_fibers( ioc, counts.size(), indexed_handler{ counts } );
+    ioc.run();
+    BOOST_CHECK( std::vector< int >( 100, 1) == counts);
+}
+
+struct ordered_handler {
+    std::vector< int > &    order;
+    int                     id;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        order.push_back( id);
+        boost::asio::post( yield);
+        order.push_back( id);
+    }
+};
+
+void spawnRange() {
+    std::vector< int > order;
+    std::vector< ordered_handler > functions;
+    for ( int i = 0; i < 3; ++i) {
+        functions.push_back( ordered_handler{ order, i } );
+    }
+    boost::asio::io_context ioc;
+    boost::spawn_fibers( boost::spawn::single_threaded{}, ioc.get_executor(), functions.begin(), functions.end() );
+    BOOST_CHECK( order.empty() );
+    ioc.run();
+    // each fiber runs until its first suspension before the next one starts
+    BOOST_CHECK( ( std::vector< int >{ 0, 1, 2, 0, 1, 2 } == order) );
+}
+
+void pooledStacks() {
+    std::vector< int > counts( 50, 0);
+    boost::spawn::pooled_stack salloc;
+    boost::asio::io_context ioc;
+    boost::spawn_fibers( ioc, counts.size(), indexed_handler{ counts }, salloc);
+    ioc.run();
+    BOOST_CHECK( std::vector< int >( 50, 1) == counts);
+    BOOST_CHECK_EQUAL(50u, salloc.statistics().misses);
+}
+
+struct throwing_handler {
+    std::vector< int > &    counts;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T >, std::size_t index) {
+        if ( 1 == index) {
+            throw std::runtime_error{ "fiber 1" };
+        }
+        ++counts[ index];
+    }
+};
+
+void exceptionInFiber() {
+    std::vector< int > counts( 3, 0);
+    boost::asio::io_context ioc;
+    boost::spawn_fibers( ioc, counts.size(), throwing_handler{ counts } );
+    BOOST_CHECK_THROW( ioc.run(), std::runtime_error);
+    // the remaining fiber still runs
+    ioc.restart();
+    ioc.run();
+    BOOST_CHECK( ( std::vector< int >{ 1, 0, 1 } == counts) );
+}
+
+void notStarted() {
+    std::vector< int > counts( 10, 0);
+    {
+        boost::asio::io_context ioc;
+        boost::spawn_fibers( ioc, counts.size(), indexed_handler{ counts } );
+    }
+    BOOST_CHECK( std::vector< int >( 10, 0) == counts);
+}
+
+struct counting_stack {
+    boost::context::fixedsize_stack     salloc;
+    int &                               stacks;
+
+    boost::context::stack_context allocate() {
+        boost::context::stack_context sctx = salloc.allocate();
+        ++stacks;
+        return sctx;
+    }
+
+    void deallocate( boost::context::stack_context & sctx) noexcept {
+        --stacks;
+        salloc.deallocate( sctx);
+    }
+};
+
+void stackAllocation() {
+    std::vector< int > counts( 10, 0);
+    int stacks = 0;
+    boost::asio::io_context ioc;
+    boost::spawn_fibers( ioc, counts.size(), indexed_handler{ counts }, counting_stack{ {}, stacks } );
+    BOOST_CHECK_EQUAL(10, stacks);
+    boost::spawn_fibers( ioc, counts.size(), indexed_handler{ counts }, counting_stack{ {}, stacks },
+                         boost::spawn::stack_allocation::deferred);
+    // the fibers of the second call hold no stack until they start
+    BOOST_CHECK_EQUAL(10, stacks);
+    ioc.run();
+    BOOST_CHECK_EQUAL(0, stacks);
+    BOOST_CHECK( std::vector< int >( 10, 2) == counts);
+}
+
+void deferredNotStarted() {
+    std::vector< int > counts( 10, 0);
+    int stacks = 0;
+    {
+        boost::asio::io_context ioc;
+        boost::spawn_fibers( ioc, counts.size(), indexed_handler{ counts }, counting_stack{ {}, stacks },
+                             boost::spawn::stack_allocation::deferred);
+        BOOST_CHECK_EQUAL(0, stacks);
+    }
+    BOOST_CHECK_EQUAL(0, stacks);
+    BOOST_CHECK( std::vector< int >( 10, 0) == counts);
+}
+
+struct pool_handler {
+    std::atomic< int > &    counter;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield, std::size_t) {
+        boost::asio::post( yield);
+        ++counter;
+    }
+};
+
+void workStealingPool() {
+    std::atomic< int > counter{ 0 };
+    boost::spawn::work_stealing_pool pool{ 4 };
+    boost::spawn_fibers( pool, 200, pool_handler{ counter } );
+    pool.join();
+    BOOST_CHECK_EQUAL(200, counter.load() );
+}
+
+boost::unit_test::test_suite * init_unit_test_suite( int, char* []) {
+    boost::unit_test::test_suite * test =
+        BOOST_TEST_SUITE("Boost.Spawn: bulk spawn test suite");
+    test->add( BOOST_TEST_CASE( & spawnIndexed) );
+    test->add( BOOST_TEST_CASE( & spawnRange) );
+    test->add( BOOST_TEST_CASE( & pooledStacks) );
+    test->add( BOOST_TEST_CASE( & exceptionInFiber) );
+    test->add( BOOST_TEST_CASE( & notStarted) );
+    test->add( BOOST_TEST_CASE( & stackAllocation) );
+    test->add( BOOST_TEST_CASE( & deferredNotStarted) );
+    test->add( BOOST_TEST_CASE( & workStealingPool) );
+    return test;
+}
@@ -0,0 +1,251 @@
+//          Copyright Oliver Kowalke 2021.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <chrono>
+#include <tuple>
+
+#include <boost/spawn.hpp>
+#include <boost/spawn/channel.hpp>
+#include <boost/spawn/condition_variable.hpp>
+#include <boost/spawn/mutex.hpp>
+#include <boost/spawn/when_all.hpp>
+
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/local/connect_pair.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/test/unit_test.hpp>
+
+// cancels the fiber of handle after ms milliseconds
+void cancel_after( boost::asio::steady_timer & timer, boost::spawn::fiber_handle & handle, int ms) {
+    timer.expires_after( std::chrono::milliseconds{ ms } );
+    timer.async_wait( [&handle]( boost::system::error_code const&) {
+        BOOST_CHECK( handle);
+        handle.cancel();
+    });
+}
+
+struct read_handler {
+    boost::asio::io_context &       ioc;
+    boost::spawn::fiber_handle &    handle;
+    boost::system::error_code &     ec;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        handle = yield.get_handle();
+        boost::asio::local::stream_protocol::socket a{ ioc }, b{ ioc };
+        boost::asio::local::connect_pair( a, b);
+        char buf[ 1];
+        yield.get_cancellation_slot().assign( [&b] { b.cancel(); });
+        b.async_read_some( boost::asio::buffer( buf), yield[ ec]);
+    }
+};
+
+void cancelRead() {
+    boost::asio::io_context ioc;
+    boost::asio::steady_timer timer{ ioc };
+    boost::spawn::fiber_handle handle;
+    boost::system::error_code ec;
+    boost::spawn_fiber( ioc, read_handler{ ioc, handle, ec } );
+    cancel_after( timer, handle, 10);
+    ioc.run();
+    BOOST_CHECK( boost::asio::error::operation_aborted == ec);
+}
+
+struct stale_handler {
+    boost::spawn::fiber_handle &    handle;
+    int &                           called;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        handle = yield.get_handle();
+        yield.get_cancellation_slot().assign( [this] { ++called; });
+        boost::asio::post( yield);
+        // the operation has completed, its handler is gone
+        BOOST_CHECK( ! yield.get_cancellation_slot().has_handler() );
+        boost::asio::post( yield);
+    }
+};
+
+void cancelAfterCompletion() {
+    boost::asio::io_context ioc;
+    boost::spawn::fiber_handle handle;
+    int called = 0;
+    boost::spawn_fiber( ioc, stale_handler{ handle, called } );
+    ioc.run_one(); // start the fiber, which suspends in post()
+    handle.cancel();
+    ioc.run();
+    BOOST_CHECK_EQUAL(0, called);
+    // the fiber has terminated
+    handle.cancel();
+    ioc.restart();
+    ioc.run();
+    BOOST_CHECK_EQUAL(0, called);
+}
+
+struct owner_handler {
+    boost::asio::io_context &   ioc;
+    boost::spawn::mutex &       mtx;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        mtx.lock( yield);
+        boost::asio::steady_timer timer{ ioc, std::chrono::milliseconds{ 50 } };
+        timer.async_wait( yield);
+        mtx.unlock();
+    }
+};
+
+struct lock_handler {
+    boost::spawn::mutex &           mtx;
+    boost::spawn::fiber_handle &    handle;
+    bool &                          aborted;
+    bool &                          locked;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        handle = yield.get_handle();
+        try {
+            mtx.lock( yield);
+        } catch ( boost::system::system_error const& e) {
+            aborted = boost::asio::error::operation_aborted == e.code();
+        }
+        // the waiter has left the queue: the mutex is still usable
+        mtx.lock( yield);
+        locked = true;
+        mtx.unlock();
+    }
+};
+
+void cancelLock() {
+    boost::asio::io_context ioc;
+    boost::asio::steady_timer timer{ ioc };
+    boost::spawn::mutex mtx;
+    boost::spawn::fiber_handle handle;
+    bool aborted = false, locked = false;
+    boost::spawn_fiber( ioc, owner_handler{ ioc, mtx } );
+    boost::spawn_fiber( ioc, lock_handler{ mtx, handle, aborted, locked } );
+    cancel_after( timer, handle, 10);
+    ioc.run();
+    BOOST_CHECK( aborted);
+    BOOST_CHECK( locked);
+    BOOST_CHECK( mtx.try_lock() );
+}
+
+struct cv_handler {
+    boost::spawn::mutex &               mtx;
+    boost::spawn::condition_variable &  cv;
+    boost::spawn::fiber_handle &        handle;
+    boost::system::error_code &         ec;
+    bool &                              owned;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        handle = yield.get_handle();
+        mtx.lock( yield);
+        cv.wait( mtx, yield[ ec], [] { return false; });
+        // locked again although the wait has failed
+        owned = ! mtx.try_lock();
+        mtx.unlock();
+    }
+};
+
+void cancelConditionWait() {
+    boost::asio::io_context ioc;
+    boost::asio::steady_timer timer{ ioc };
+    boost::spawn::mutex mtx;
+    boost::spawn::condition_variable cv;
+    boost::spawn::fiber_handle handle;
+    boost::system::error_code ec;
+    bool owned = false;
+    boost::spawn_fiber( ioc, cv_handler{ mtx, cv, handle, ec, owned } );
+    cancel_after( timer, handle, 10);
+    ioc.run();
+    BOOST_CHECK( boost::asio::error::operation_aborted == ec);
+    BOOST_CHECK( owned);
+}
+
+struct receive_handler {
+    boost::spawn::channel< int > &  chan;
+    boost::spawn::fiber_handle &    handle;
+    boost::system::error_code &     ec;
+    int &                           value;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        handle = yield.get_handle();
+        chan.receive( yield[ ec]);
+        chan.send( 42, yield);
+        value = chan.receive( yield);
+    }
+};
+
+void cancelReceive() {
+    boost::asio::io_context ioc;
+    boost::asio::steady_timer timer{ ioc };
+    boost::spawn::channel< int > chan{ 1 };
+    boost::spawn::fiber_handle handle;
+    boost::system::error_code ec;
+    int value = 0;
+    boost::spawn_fiber( ioc, receive_handler{ chan, handle, ec, value } );
+    cancel_after( timer, handle, 10);
+    ioc.run();
+    BOOST_CHECK( boost::asio::error::operation_aborted == ec);
+    BOOST_CHECK_EQUAL(42, value);
+}
+
+struct group_handler {
+    boost::asio::io_context &       ioc;
+    boost::spawn::fiber_handle &    handle;
+    int &                           aborted;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        handle = yield.get_handle();
+        boost::asio::steady_timer t1{ ioc, std::chrono::hours{ 1 } };
+        boost::asio::steady_timer t2{ ioc, std::chrono::hours{ 1 } };
+        auto r = boost::spawn::when_all( yield,
+                [&]( auto token) {
+                    token.get_cancellation_slot().assign( [&t1] { t1.cancel(); });
+                    return t1.async_wait( token);
+                },
+                [&]( auto token) {
+                    token.get_cancellation_slot().assign( [&t2] { t2.cancel(); });
+                    return t2.async_wait( token);
+                });
+        if ( boost::asio::error::operation_aborted == std::get< 0 >( std::get< 0 >( r) ) ) {
+            ++aborted;
+        }
+        if ( boost::asio::error::operation_aborted == std::get< 0 >( std::get< 1 >( r) ) ) {
+            ++aborted;
+        }
+    }
+};
+
+void cancelWhenAll() {
+    boost::asio::io_context ioc;
+    boost::asio::steady_timer timer{ ioc };
+    boost::spawn::fiber_handle handle;
+    int aborted = 0;
+    boost::spawn_fiber( ioc, group_handler{ ioc, handle, aborted } );
+    cancel_after( timer, handle, 10);
+    ioc.run();
+    BOOST_CHECK_EQUAL(2, aborted);
+}
+
+boost::unit_test::test_suite * init_unit_test_suite( int, char* []) {
+    boost::unit_test::test_suite * test =
+        BOOST_TEST_SUITE("Boost.Spawn: cancellation test suite");
+    test->add( BOOST_TEST_CASE( & cancelRead) );
+    test->add( BOOST_TEST_CASE( & cancelAfterCompletion) );
+    test->add( BOOST_TEST_CASE( & cancelLock) );
+    test->add( BOOST_TEST_CASE( & cancelConditionWait) );
+    test->add( BOOST_TEST_CASE( & cancelReceive) );
+    test->add( BOOST_TEST_CASE( & cancelWhenAll) );
+    return test;
+}
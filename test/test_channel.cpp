@@ -0,0 +1,294 @@
+//          Copyright Oliver Kowalke 2021.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <boost/spawn.hpp>
+#include <boost/spawn/channel.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/optional.hpp>
+#include <boost/system/error_code.hpp>
+#include <boost/test/unit_test.hpp>
+
+typedef boost::spawn::channel< int > channel_type;
+
+void run_threads( boost::asio::io_context & ioc, int n) {
+    std::vector< std::thread > threads;
+    for ( int i = 0; i < n; ++i) {
+        threads.emplace_back( [&ioc] { ioc.run(); });
+    }
+    for ( std::thread & t : threads) {
+        t.join();
+    }
+}
+
+struct producer_handler {
+    channel_type &  chan;
+    int             first;
+    int             n;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        for ( int i = first; i < first + n; ++i) {
+            chan.send( i, yield);
+            BOOST_CHECK( chan.size() <= chan.capacity() );
+        }
+    }
+};
+
+struct consumer_handler {
+    channel_type &      chan;
+    std::vector< int > & received;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        boost::system::error_code ec;
+        for (;;) {
+            int i = chan.receive( yield[ec]);
+            if ( ec) {
+                BOOST_CHECK( boost::spawn::channel_errc::closed == ec);
+                break;
+            }
+            received.push_back( i);
+        }
+    }
+};
+
+struct closing_handler {
+    channel_type &  chan;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        producer_handler{ chan, 0, 100 }( yield);
+        chan.close();
+    }
+};
+
+void channelFifo() {
+    channel_type chan{ 4 };
+    std::vector< int > received;
+    boost::asio::io_context ioc;
+    boost::spawn_fiber( ioc, consumer_handler{ chan, received } );
+    boost::spawn_fiber( ioc, closing_handler{ chan } );
+    ioc.run();
+    BOOST_REQUIRE_EQUAL(100u, received.size() );
+    for ( int i = 0; i < 100; ++i) {
+        BOOST_CHECK_EQUAL(i, received[ i]);
+    }
+}
+
+struct drain_handler {
+    channel_type &  chan;
+    int &           sum;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        chan.send( 1, yield);
+        chan.send( 2, yield);
+        chan.send( 3, yield);
+        chan.close();
+        BOOST_CHECK_THROW(chan.send( 4, yield), boost::system::system_error);
+        boost::system::error_code ec;
+        chan.send( 4, yield[ec]);
+        BOOST_CHECK( boost::spawn::channel_errc::closed == ec);
+        sum += chan.receive( yield);
+        sum += chan.receive( yield);
+        sum += chan.receive( yield);
+        chan.receive( yield[ec]);
+        BOOST_CHECK( boost::spawn::channel_errc::closed == ec);
+        BOOST_CHECK_THROW(chan.receive( yield), boost::system::system_error);
+    }
+};
+
+void channelCloseDrains() {
+    channel_type chan{ 4 };
+    int sum = 0;
+    boost::asio::io_context ioc;
+    boost::spawn_fiber( ioc, drain_handler{ chan, sum } );
+    ioc.run();
+    BOOST_CHECK_EQUAL(6, sum);
+    BOOST_CHECK( chan.is_closed() );
+}
+
+struct close_handler {
+    channel_type &  chan;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        boost::asio::post( yield);
+        chan.close();
+    }
+};
+
+void channelCloseWakesReceivers() {
+    channel_type chan{ 1 };
+    std::vector< int > r1, r2;
+    boost::asio::io_context ioc;
+    boost::spawn_fiber( ioc, consumer_handler{ chan, r1 } );
+    boost::spawn_fiber( ioc, consumer_handler{ chan, r2 } );
+    boost::spawn_fiber( ioc, close_handler{ chan } );
+    ioc.run();
+    BOOST_CHECK( r1.empty() );
+    BOOST_CHECK( r2.empty() );
+}
+
+struct mpmc_producer {
+    channel_type &          chan;
+    std::atomic< int > &    producers;
+    int                     first;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        producer_handler{ chan, first, 1000 }( yield);
+        if ( 0 == --producers) {
+            chan.close();
+        }
+    }
+};
+
+struct mpmc_consumer {
+    channel_type &              chan;
+    std::atomic< long long > &  sum;
+    std::atomic< int > &        count;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        boost::system::error_code ec;
+        for (;;) {
+            int i = chan.receive( yield[ec]);
+            if ( ec) {
+                break;
+            }
+            sum += i;
+            ++count;
+        }
+    }
+};
+
+void channelMultipleProducersConsumers() {
+    channel_type chan{ 8 };
+    std::atomic< int > producers{ 4 }, count{ 0 };
+    std::atomic< long long > sum{ 0 };
+    boost::asio::io_context ioc{ 4 };
+    for ( int i = 0; i < 4; ++i) {
+        boost::spawn_fiber( ioc, mpmc_producer{ chan, producers, i * 1000 } );
+        boost::spawn_fiber( ioc, mpmc_consumer{ chan, sum, count } );
+    }
+    run_threads( ioc, 4);
+    BOOST_CHECK_EQUAL(4000, count.load() );
+    BOOST_CHECK_EQUAL(3999LL * 4000LL / 2, sum.load() );
+}
+
+struct move_only_handler {
+    boost::spawn::channel< std::unique_ptr< int > > &   chan;
+    int &                                               result;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        chan.send( std::unique_ptr< int >{ new int{ 42 } }, yield);
+        std::unique_ptr< int > p = chan.receive( yield);
+        result = * p;
+    }
+};
+
+void channelMoveOnly() {
+    boost::spawn::channel< std::unique_ptr< int > > chan{ 1 };
+    int result = 0;
+    boost::asio::io_context ioc;
+    boost::spawn_fiber( ioc, move_only_handler{ chan, result } );
+    ioc.run();
+    BOOST_CHECK_EQUAL(42, result);
+}
+
+// has no default constructor
+struct payload {
+    explicit payload( int v) :
+        value{ v } {
+    }
+
+    int     value;
+};
+
+struct no_default_handler {
+    boost::spawn::channel< payload > &  chan;
+    int &                               result;
+    bool &                              closed;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        boost::optional< payload > p;
+        // waits for the sender
+        chan.receive( p, yield);
+        result = p->value;
+        boost::system::error_code ec;
+        chan.receive( p, yield[ec]);
+        closed = boost::spawn::channel_errc::closed == ec && ! p;
+    }
+};
+
+void channelNoDefaultConstructor() {
+    boost::spawn::channel< payload > chan{ 1 };
+    int result = 0;
+    bool closed = false;
+    boost::asio::io_context ioc;
+    boost::spawn_fiber( ioc, no_default_handler{ chan, result, closed } );
+    boost::spawn_fiber( ioc, [&chan]( boost::spawn::yield_context yield) {
+                chan.send( payload{ 42 }, yield);
+                chan.close();
+            });
+    ioc.run();
+    BOOST_CHECK_EQUAL(42, result);
+    BOOST_CHECK( closed);
+}
+
+struct flag {
+    bool &  value;
+
+    ~flag() {
+        value = true;
+    }
+};
+
+struct blocked_sender {
+    channel_type &  chan;
+    bool &          unwound;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        flag f{ unwound };
+        chan.send( 1, yield);
+        chan.send( 2, yield); // full
+        BOOST_ERROR("send() must not return");
+    }
+};
+
+void channelDestroyUnwindsWaiters() {
+    bool unwound = false;
+    boost::asio::io_context ioc;
+    std::unique_ptr< channel_type > chan{ new channel_type{ 1 } };
+    boost::spawn_fiber( ioc, blocked_sender{ * chan, unwound } );
+    ioc.run();
+    BOOST_CHECK( ! unwound);
+    chan.reset();
+    BOOST_CHECK( unwound);
+}
+
+boost::unit_test::test_suite * init_unit_test_suite( int, char* []) {
+    boost::unit_test::test_suite * test =
+        BOOST_TEST_SUITE("Boost.Spawn: channel test suite");
+    test->add( BOOST_TEST_CASE( & channelFifo) );
+    test->add( BOOST_TEST_CASE( & channelCloseDrains) );
+    test->add( BOOST_TEST_CASE( & channelCloseWakesReceivers) );
+    test->add( BOOST_TEST_CASE( & channelMultipleProducersConsumers) );
+    test->add( BOOST_TEST_CASE( & channelMoveOnly) );
+    test->add( BOOST_TEST_CASE( & channelNoDefaultConstructor) );
+    test->add( BOOST_TEST_CASE( & channelDestroyUnwindsWaiters) );
+    return test;
+}
@@ -0,0 +1,131 @@
+//          Copyright Oliver Kowalke 2021.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <chrono>
+#include <stdexcept>
+#include <vector>
+
+#include <boost/spawn.hpp>
+#include <boost/spawn/coroutine.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/test/unit_test.hpp>
+
+#if defined(BOOST_ASIO_HAS_CO_AWAIT)
+
+void waitTimer() {
+    int expired = 0;
+    boost::asio::io_context ioc;
+    boost::spawn_fiber( boost::spawn::stackless{}, ioc,
+        [&expired]( boost::spawn::coroutine_context ctx) -> boost::asio::awaitable< void > {
+            boost::asio::steady_timer timer{ ctx.get_executor() };
+            for ( int i = 0; i < 3; ++i) {
+                timer.expires_after( std::chrono::milliseconds{ 1 } );
+                co_await timer.async_wait( ctx);
+                ++expired;
+            }
+        });
+    BOOST_CHECK_EQUAL(0, expired);
+    ioc.run();
+    BOOST_CHECK_EQUAL(3, expired);
+}
+
+void errorCode() {
+    boost::system::error_code ec;
+    boost::asio::io_context ioc;
+    boost::asio::steady_timer timer{ ioc };
+    timer.expires_after( std::chrono::hours{ 1 } );
+    boost::spawn_fiber( boost::spawn::stackless{}, ioc,
+        [&]( boost::spawn::coroutine_context ctx) -> boost::asio::awaitable< void > {
+            co_await timer.async_wait( ctx[ ec]);
+        });
+    boost::asio::post( ioc, [&timer] { timer.cancel(); });
+    ioc.run();
+    BOOST_CHECK( boost::asio::error::operation_aborted == ec);
+}
+
+void throwingOperation() {
+    bool caught = false;
+    boost::asio::io_context ioc;
+    boost::asio::steady_timer timer{ ioc };
+    timer.expires_after( std::chrono::hours{ 1 } );
+    boost::spawn_fiber( boost::spawn::stackless{}, ioc,
+        [&]( boost::spawn::coroutine_context ctx) -> boost::asio::awaitable< void > {
+            try {
+                co_await timer.async_wait( ctx);
+            } catch ( boost::system::system_error const& e) {
+                caught = boost::asio::error::operation_aborted == e.code();
+            }
+        });
+    boost::asio::post( ioc, [&timer] { timer.cancel(); });
+    ioc.run();
+    BOOST_CHECK( caught);
+}
+
+void exceptionLeavesRun() {
+    boost::asio::io_context ioc;
+    boost::spawn_fiber( boost::spawn::stackless{}, ioc.get_executor(),
+        []( boost::spawn::coroutine_context ctx) -> boost::asio::awaitable< void > {
+            co_await boost::asio::post( ctx);
+            throw std::runtime_error{ "coroutine" };
+        });
+    BOOST_CHECK_THROW( ioc.run(), std::runtime_error);
+}
+
+struct fiber_handler {
+    std::vector< int > &    order;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        order.push_back( 1);
+        // the coroutine starts once the fiber has suspended
+        boost::spawn_fiber( boost::spawn::stackless{}, yield,
+            [this]( boost::spawn::coroutine_context ctx) -> boost::asio::awaitable< void > {
+                order.push_back( 3);
+                co_await boost::asio::post( ctx);
+                order.push_back( 4);
+            });
+        order.push_back( 2);
+        boost::asio::post( yield);
+        boost::asio::post( yield);
+        order.push_back( 5);
+    }
+};
+
+void spawnFromFiber() {
+    std::vector< int > order;
+    boost::asio::io_context ioc;
+    boost::spawn_fiber( ioc, fiber_handler{ order } );
+    ioc.run();
+    BOOST_CHECK( ( std::vector< int >{ 1, 2, 3, 4, 5 } == order) );
+}
+
+boost::unit_test::test_suite * init_unit_test_suite( int, char* []) {
+    boost::unit_test::test_suite * test =
+        BOOST_TEST_SUITE("Boost.Spawn: coroutine test suite");
+    test->add( BOOST_TEST_CASE( & waitTimer) );
+    test->add( BOOST_TEST_CASE( & errorCode) );
+    test->add( BOOST_TEST_CASE( & throwingOperation) );
+    test->add( BOOST_TEST_CASE( & exceptionLeavesRun) );
+    test->add( BOOST_TEST_CASE( & spawnFromFiber) );
+    return test;
+}
+
+#else
+
+void coroutinesUnavailable() {
+    BOOST_TEST_MESSAGE("C++20 coroutines are not available, the stackless backend is not tested");
+}
+
+boost::unit_test::test_suite * init_unit_test_suite( int, char* []) {
+    boost::unit_test::test_suite * test =
+        BOOST_TEST_SUITE("Boost.Spawn: coroutine test suite");
+    test->add( BOOST_TEST_CASE( & coroutinesUnavailable) );
+    return test;
+}
+
+#endif
@@ -0,0 +1,151 @@
+//          Copyright Oliver Kowalke 2021.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <chrono>
+#include <vector>
+
+#include <boost/spawn.hpp>
+#include <boost/spawn/channel.hpp>
+#include <boost/spawn/mutex.hpp>
+
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/local/connect_pair.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/test/unit_test.hpp>
+
+struct read_handler {
+    boost::asio::io_context &       ioc;
+    boost::system::error_code &     ec;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        boost::asio::local::stream_protocol::socket a{ ioc }, b{ ioc };
+        boost::asio::local::connect_pair( a, b);
+        char buf[ 1];
+        yield.get_cancellation_slot().assign( [&b] { b.cancel(); });
+        b.async_read_some( boost::asio::buffer( buf), yield.with_timeout( std::chrono::milliseconds{ 10 })[ ec]);
+    }
+};
+
+void timeoutRead() {
+    boost::asio::io_context ioc;
+    boost::system::error_code ec;
+    const auto start = std::chrono::steady_clock::now();
+    boost::spawn_fiber( ioc, read_handler{ ioc, ec } );
+    ioc.run();
+    BOOST_CHECK( boost::asio::error::timed_out == ec);
+    BOOST_CHECK( std::chrono::milliseconds{ 10 } <= std::chrono::steady_clock::now() - start);
+}
+
+struct complete_handler {
+    boost::asio::io_context &       ioc;
+    boost::system::error_code &     ec;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        auto timed = yield.with_timeout( std::chrono::hours{ 1 })[ ec];
+        for ( int i = 0; i < 10; ++i) {
+            boost::asio::post( timed);
+        }
+        // without a cancellation handler the operation runs to completion
+        boost::asio::steady_timer timer{ ioc, std::chrono::milliseconds{ 20 } };
+        timer.async_wait( yield.with_timeout( std::chrono::milliseconds{ 5 })[ ec]);
+    }
+};
+
+void completeBeforeDeadline() {
+    boost::asio::io_context ioc;
+    boost::system::error_code ec;
+    const auto start = std::chrono::steady_clock::now();
+    boost::spawn_fiber( ioc, complete_handler{ ioc, ec } );
+    ioc.run();
+    BOOST_CHECK( ! ec);
+    // the pending deadline does not keep the io_context running
+    BOOST_CHECK( std::chrono::minutes{ 1 } > std::chrono::steady_clock::now() - start);
+}
+
+struct owner_handler {
+    boost::asio::io_context &   ioc;
+    boost::spawn::mutex &       mtx;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        mtx.lock( yield);
+        boost::asio::steady_timer timer{ ioc, std::chrono::milliseconds{ 50 } };
+        timer.async_wait( yield);
+        mtx.unlock();
+    }
+};
+
+struct lock_handler {
+    boost::spawn::mutex &   mtx;
+    bool &                  timed_out;
+    bool &                  locked;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        try {
+            mtx.lock( yield.with_timeout( std::chrono::milliseconds{ 10 }) );
+        } catch ( boost::system::system_error const& e) {
+            timed_out = boost::asio::error::timed_out == e.code();
+        }
+        // the waiter has left the queue: the mutex is still usable
+        mtx.lock( yield);
+        locked = true;
+        mtx.unlock();
+    }
+};
+
+void timeoutLock() {
+    boost::asio::io_context ioc;
+    boost::spawn::mutex mtx;
+    bool timed_out = false, locked = false;
+    boost::spawn_fiber( ioc, owner_handler{ ioc, mtx } );
+    boost::spawn_fiber( ioc, lock_handler{ mtx, timed_out, locked } );
+    ioc.run();
+    BOOST_CHECK( timed_out);
+    BOOST_CHECK( locked);
+    BOOST_CHECK( mtx.try_lock() );
+}
+
+struct receive_handler {
+    boost::spawn::channel< int > &  chan;
+    std::vector< int > &            expired;
+    int                             ms;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        boost::system::error_code ec;
+        chan.receive( yield.with_timeout( std::chrono::milliseconds{ ms })[ ec]);
+        if ( boost::asio::error::timed_out == ec) {
+            expired.push_back( ms);
+        }
+    }
+};
+
+void deadlineOrder() {
+    boost::asio::io_context ioc;
+    boost::spawn::channel< int > chan{ 1 };
+    std::vector< int > expired;
+    for ( int ms : { 30, 10, 40, 20, 10 }) {
+        boost::spawn_fiber( ioc, receive_handler{ chan, expired, ms } );
+    }
+    ioc.run();
+    BOOST_CHECK( ( std::vector< int >{ 10, 10, 20, 30, 40 } == expired) );
+}
+
+boost::unit_test::test_suite * init_unit_test_suite( int, char* []) {
+    boost::unit_test::test_suite * test =
+        BOOST_TEST_SUITE("Boost.Spawn: deadline test suite");
+    test->add( BOOST_TEST_CASE( & timeoutRead) );
+    test->add( BOOST_TEST_CASE( & completeBeforeDeadline) );
+    test->add( BOOST_TEST_CASE( & timeoutLock) );
+    test->add( BOOST_TEST_CASE( & deadlineOrder) );
+    return test;
+}
@@ -0,0 +1,164 @@
+//          Copyright Oliver Kowalke 2021.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <boost/spawn.hpp>
+#include <boost/spawn/fiber_specific_ptr.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/system_timer.hpp>
+#include <boost/test/unit_test.hpp>
+
+typedef boost::asio::system_timer timer_type;
+
+static std::atomic< int > cleanups{ 0 };
+
+void count_cleanup( int * p) {
+    ++cleanups;
+    delete p;
+}
+
+struct value_handler {
+    boost::spawn::fiber_specific_ptr< int > &   fsp;
+    int                                         value;
+    int &                                       mismatches;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        BOOST_CHECK( nullptr == fsp.get() );
+        fsp.reset( new int{ value } );
+        for ( int i = 0; i < 10; ++i) {
+            boost::asio::post( yield);
+            if ( nullptr == fsp.get() || value != * fsp) {
+                ++mismatches;
+            }
+        }
+    }
+};
+
+void fssPerFiber() {
+    cleanups = 0;
+    boost::spawn::fiber_specific_ptr< int > fsp{ & count_cleanup };
+    int mismatches = 0;
+    {
+        boost::asio::io_context ioc;
+        auto ex = ioc.get_executor();
+        boost::spawn_fiber( ex, value_handler{ fsp, 1, mismatches } );
+        boost::spawn_fiber( ex, value_handler{ fsp, 2, mismatches } );
+        boost::spawn_fiber( ex, value_handler{ fsp, 3, mismatches } );
+        ioc.run();
+    }
+    BOOST_CHECK_EQUAL(0, mismatches);
+    BOOST_CHECK_EQUAL(3, cleanups.load() );
+    BOOST_CHECK( nullptr == fsp.get() );
+}
+
+void fssMultipleThreads() {
+    cleanups = 0;
+    boost::spawn::fiber_specific_ptr< int > fsp{ & count_cleanup };
+    int mismatches[ 20 ] = {};
+    boost::asio::io_context ioc{ 4 };
+    for ( int i = 0; i < 20; ++i) {
+        boost::spawn_fiber( ioc, value_handler{ fsp, i, mismatches[ i] } );
+    }
+    std::vector< std::thread > threads;
+    for ( int i = 0; i < 4; ++i) {
+        threads.emplace_back( [&ioc] { ioc.run(); });
+    }
+    for ( std::thread & t : threads) {
+        t.join();
+    }
+    for ( int m : mismatches) {
+        BOOST_CHECK_EQUAL(0, m);
+    }
+    BOOST_CHECK_EQUAL(20, cleanups.load() );
+}
+
+struct reset_handler {
+    boost::spawn::fiber_specific_ptr< int > &   fsp;
+    int * &                                     released;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T >) {
+        fsp.reset( new int{ 1 } );
+        fsp.reset( new int{ 2 } ); // cleans up 1
+        fsp.reset( fsp.get() ); // no-op
+        released = fsp.release();
+        fsp.reset( new int{ 3 } ); // cleaned up on exit
+    }
+};
+
+void fssResetRelease() {
+    cleanups = 0;
+    boost::spawn::fiber_specific_ptr< int > fsp{ & count_cleanup };
+    int * released = nullptr;
+    boost::asio::io_context ioc;
+    boost::spawn_fiber( ioc, reset_handler{ fsp, released } );
+    ioc.run();
+    BOOST_CHECK_EQUAL(2, cleanups.load() );
+    BOOST_REQUIRE( nullptr != released);
+    BOOST_CHECK_EQUAL(2, * released);
+    delete released;
+}
+
+struct wait_handler {
+    boost::spawn::fiber_specific_ptr< int > &   fsp;
+    timer_type &                                timer;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        fsp.reset( new int{ 1 } );
+        timer.async_wait( yield);
+    }
+};
+
+void fssForcedUnwind() {
+    cleanups = 0;
+    boost::spawn::fiber_specific_ptr< int > fsp{ & count_cleanup };
+    {
+        boost::asio::io_context ioc;
+        timer_type timer{ ioc, boost::asio::chrono::hours{ 65536 } };
+        boost::spawn_fiber( ioc, wait_handler{ fsp, timer } );
+        ioc.run_one();
+        BOOST_CHECK_EQUAL(0, cleanups.load() );
+    }
+    BOOST_CHECK_EQUAL(1, cleanups.load() );
+}
+
+struct throw_handler {
+    boost::spawn::fiber_specific_ptr< int > &   fsp;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        fsp.reset( new int{ 1 } );
+        boost::asio::post( yield);
+        throw std::runtime_error{ "throw_handler" };
+    }
+};
+
+void fssException() {
+    cleanups = 0;
+    boost::spawn::fiber_specific_ptr< int > fsp{ & count_cleanup };
+    boost::asio::io_context ioc;
+    boost::spawn_fiber( ioc, throw_handler{ fsp } );
+    BOOST_CHECK_THROW(ioc.run(), std::runtime_error);
+    BOOST_CHECK_EQUAL(1, cleanups.load() );
+}
+
+boost::unit_test::test_suite * init_unit_test_suite( int, char* []) {
+    boost::unit_test::test_suite * test =
+        BOOST_TEST_SUITE("Boost.Spawn: fiber_specific_ptr test suite");
+    test->add( BOOST_TEST_CASE( & fssPerFiber) );
+    test->add( BOOST_TEST_CASE( & fssMultipleThreads) );
+    test->add( BOOST_TEST_CASE( & fssResetRelease) );
+    test->add( BOOST_TEST_CASE( & fssForcedUnwind) );
+    test->add( BOOST_TEST_CASE( & fssException) );
+    return test;
+}
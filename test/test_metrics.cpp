@@ -0,0 +1,120 @@
+//          Copyright Oliver Kowalke 2021.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// compiled with BOOST_SPAWN_ENABLE_METRICS defined
+
+#include <stdexcept>
+
+#include <boost/spawn.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/system_timer.hpp>
+#include <boost/context/fixedsize_stack.hpp>
+#include <boost/test/unit_test.hpp>
+
+typedef boost::asio::system_timer timer_type;
+
+struct post_handler {
+    boost::asio::io_context &           ioc;
+    boost::spawn::executor_metrics &    inner;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        boost::asio::post( yield);
+        inner = boost::spawn::metrics_snapshot( ioc);
+    }
+};
+
+struct wait_handler {
+    timer_type &    timer;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        boost::system::error_code ec;
+        timer.async_wait( yield[ec]);
+    }
+};
+
+struct throw_handler {
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        boost::asio::post( yield);
+        throw std::runtime_error{ "throw_handler" };
+    }
+};
+
+void metricsNoFibers() {
+    boost::asio::io_context ioc;
+    boost::spawn::executor_metrics m = boost::spawn::metrics_snapshot( ioc);
+    BOOST_CHECK_EQUAL(0u, m.spawned);
+    BOOST_CHECK_EQUAL(0u, m.live_fibers);
+    BOOST_CHECK( m.fibers.empty() );
+}
+
+void metricsCompletedFiber() {
+    boost::asio::io_context ioc;
+    boost::spawn::executor_metrics inner;
+    boost::spawn_fiber( ioc, post_handler{ ioc, inner }, boost::context::fixedsize_stack{ 65536 } );
+    ioc.run();
+
+    BOOST_CHECK_EQUAL(1u, inner.live_fibers);
+    BOOST_CHECK_EQUAL(65536u, inner.stack_bytes);
+    BOOST_REQUIRE_EQUAL(1u, inner.fibers.size() );
+    BOOST_CHECK_EQUAL(1u, inner.fibers[0].id);
+    BOOST_CHECK_EQUAL(2u, inner.fibers[0].resumes);
+    BOOST_CHECK_EQUAL(1u, inner.fibers[0].suspensions);
+    BOOST_CHECK_EQUAL(65536u, inner.fibers[0].stack_size);
+
+    boost::spawn::executor_metrics m = boost::spawn::metrics_snapshot( ioc);
+    BOOST_CHECK_EQUAL(1u, m.spawned);
+    BOOST_CHECK_EQUAL(0u, m.live_fibers);
+    BOOST_CHECK_EQUAL(0u, m.stack_bytes);
+    BOOST_CHECK_EQUAL(2u, m.resumes);
+    BOOST_CHECK_EQUAL(1u, m.suspensions);
+    BOOST_CHECK_EQUAL(0u, m.exceptions);
+    BOOST_CHECK( m.fibers.empty() );
+}
+
+void metricsSuspendedFiber() {
+    boost::asio::io_context ioc;
+    timer_type timer{ ioc, boost::asio::chrono::hours{ 65536 } };
+    boost::spawn_fiber( ioc, wait_handler{ timer }, boost::context::fixedsize_stack{ 65536 } );
+    boost::spawn_fiber( ioc, wait_handler{ timer }, boost::context::fixedsize_stack{ 65536 } );
+    ioc.poll();
+
+    boost::spawn::executor_metrics m = boost::spawn::metrics_snapshot( ioc);
+    BOOST_CHECK_EQUAL(2u, m.spawned);
+    BOOST_CHECK_EQUAL(2u, m.live_fibers);
+    BOOST_CHECK_EQUAL(2u * 65536u, m.stack_bytes);
+    BOOST_CHECK_EQUAL(2u, m.suspensions);
+    BOOST_CHECK_EQUAL(2u, m.fibers.size() );
+
+    timer.cancel();
+    ioc.run();
+    m = boost::spawn::metrics_snapshot( ioc);
+    BOOST_CHECK_EQUAL(0u, m.live_fibers);
+    BOOST_CHECK_EQUAL(4u, m.resumes);
+}
+
+void metricsException() {
+    boost::asio::io_context ioc;
+    boost::spawn_fiber( ioc, throw_handler{} );
+    BOOST_CHECK_THROW(ioc.run(), std::runtime_error);
+
+    boost::spawn::executor_metrics m = boost::spawn::metrics_snapshot( ioc);
+    BOOST_CHECK_EQUAL(1u, m.exceptions);
+    BOOST_CHECK_EQUAL(0u, m.live_fibers);
+}
+
+boost::unit_test::test_suite * init_unit_test_suite( int, char* []) {
+    boost::unit_test::test_suite * test =
+        BOOST_TEST_SUITE("Boost.Spawn: metrics test suite");
+    test->add( BOOST_TEST_CASE( & metricsNoFibers) );
+    test->add( BOOST_TEST_CASE( & metricsCompletedFiber) );
+    test->add( BOOST_TEST_CASE( & metricsSuspendedFiber) );
+    test->add( BOOST_TEST_CASE( & metricsException) );
+    return test;
+}
@@ -0,0 +1,40 @@
+//          Copyright Oliver Kowalke 2021.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// second translation unit of test_multiple_units.cpp
+
+#include <cstddef>
+
+#include <boost/spawn.hpp>
+#include <boost/spawn/bulk_spawn.hpp>
+#include <boost/spawn/cancellation.hpp>
+#include <boost/spawn/channel.hpp>
+#include <boost/spawn/concurrency_policy.hpp>
+#include <boost/spawn/condition_variable.hpp>
+#include <boost/spawn/coroutine.hpp>
+#include <boost/spawn/fiber_specific_ptr.hpp>
+#include <boost/spawn/metrics.hpp>
+#include <boost/spawn/mutex.hpp>
+#include <boost/spawn/pooled_stack.hpp>
+#include <boost/spawn/result.hpp>
+#include <boost/spawn/semaphore.hpp>
+#include <boost/spawn/sharded_runtime.hpp>
+#include <boost/spawn/stack_usage.hpp>
+#include <boost/spawn/when_all.hpp>
+#include <boost/spawn/when_any.hpp>
+#include <boost/spawn/work_stealing_pool.hpp>
+
+#include <boost/asio/io_context.hpp>
+
+std::size_t const& other_unit_npos() {
+    return boost::spawn::sharded_runtime::npos;
+}
+
+int other_unit_spawn( boost::asio::io_context & ioc) {
+    int called = 0;
+    boost::spawn_fiber( ioc, [&called]( boost::spawn::yield_context) { ++called; });
+    ioc.run();
+    return called;
+}
@@ -0,0 +1,77 @@
+//          Copyright Oliver Kowalke 2021.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <thread>
+
+#include <boost/spawn.hpp>
+#include <boost/spawn/pooled_stack.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/test/unit_test.hpp>
+
+static_assert(boost::spawn::detail::is_stack_allocator< boost::spawn::pooled_stack >::value,
+              "pooled_stack must model the stack-allocator concept");
+
+struct noop_handler {
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T >) {
+    }
+};
+
+void pooledStackRecycles() {
+    boost::spawn::pooled_stack salloc{ 65536 };
+    boost::asio::io_context ioc;
+    for ( int i = 0; i < 10; ++i) {
+        boost::spawn_fiber( ioc, noop_handler{}, salloc);
+        ioc.run();
+        ioc.restart();
+    }
+    boost::spawn::pooled_stack_statistics stats = salloc.statistics();
+    BOOST_CHECK_EQUAL(1u, stats.misses);
+    BOOST_CHECK_EQUAL(9u, stats.thread_hits);
+    BOOST_CHECK_EQUAL(0u, stats.releases);
+}
+
+void pooledStackBounded() {
+    boost::spawn::pooled_stack salloc{ 65536, 0, 1 };
+    boost::context::stack_context s1 = salloc.allocate();
+    boost::context::stack_context s2 = salloc.allocate();
+    boost::context::stack_context s3 = salloc.allocate();
+    salloc.deallocate( s1);
+    salloc.deallocate( s2);
+    salloc.deallocate( s3);
+    boost::spawn::pooled_stack_statistics stats = salloc.statistics();
+    BOOST_CHECK_EQUAL(3u, stats.misses);
+    BOOST_CHECK_EQUAL(1u, stats.spills);
+    BOOST_CHECK_EQUAL(2u, stats.releases);
+    BOOST_CHECK_EQUAL(1u, stats.global_cached);
+    boost::context::stack_context s4 = salloc.allocate();
+    BOOST_CHECK_EQUAL(1u, salloc.statistics().global_hits);
+    salloc.deallocate( s4);
+}
+
+void pooledStackThreadExitSpills() {
+    boost::spawn::pooled_stack salloc{ 65536, 4, 4 };
+    boost::context::stack_context sctx = salloc.allocate();
+    std::thread t{ [&salloc,&sctx] () {
+        salloc.deallocate( sctx);
+    } };
+    t.join();
+    boost::spawn::pooled_stack_statistics stats = salloc.statistics();
+    BOOST_CHECK_EQUAL(1u, stats.spills);
+    BOOST_CHECK_EQUAL(1u, stats.global_cached);
+    sctx = salloc.allocate();
+    BOOST_CHECK_EQUAL(1u, salloc.statistics().global_hits);
+    salloc.deallocate( sctx);
+}
+
+boost::unit_test::test_suite * init_unit_test_suite( int, char* []) {
+    boost::unit_test::test_suite * test =
+        BOOST_TEST_SUITE("Boost.Spawn: pooled_stack test suite");
+    test->add( BOOST_TEST_CASE( & pooledStackRecycles) );
+    test->add( BOOST_TEST_CASE( & pooledStackBounded) );
+    test->add( BOOST_TEST_CASE( & pooledStackThreadExitSpills) );
+    return test;
+}
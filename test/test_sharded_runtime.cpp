@@ -0,0 +1,148 @@
+//          Copyright Oliver Kowalke 2021.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+#include <thread>
+
+#include <boost/spawn.hpp>
+#include <boost/spawn/sharded_runtime.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/test/unit_test.hpp>
+
+struct where_handler {
+    boost::spawn::sharded_runtime & rt;
+    std::size_t                     shard;
+    std::atomic< int > &            matched;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T >) {
+        if ( rt.current_shard() == shard) {
+            ++matched;
+        }
+    }
+};
+
+void spawnOn() {
+    std::atomic< int > matched{ 0 };
+    boost::spawn::sharded_runtime rt{ 4 };
+    BOOST_CHECK_EQUAL(4u, rt.size() );
+    BOOST_CHECK_EQUAL(boost::spawn::sharded_runtime::npos, rt.current_shard() );
+    for ( std::size_t i = 0; i < rt.size(); ++i) {
+        rt.spawn_on( i, where_handler{ rt, i, matched } );
+    }
+    rt.join();
+    BOOST_CHECK_EQUAL(4, matched.load() );
+}
+
+struct caller_handler {
+    boost::spawn::sharded_runtime & rt;
+    std::size_t &                   sum;
+    bool &                          remote;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        remote = true;
+        for ( std::size_t i = 0; i < 1000; ++i) {
+            const std::size_t target = 1 + i % ( rt.size() - 1);
+            sum += rt.call_on( target, [&] {
+                remote = remote && rt.current_shard() == target;
+                return i;
+            }, yield);
+        }
+        // the caller is back on its own shard
+        remote = remote && 0 == rt.current_shard();
+    }
+};
+
+void callOn() {
+    std::size_t sum = 0;
+    bool remote = false;
+    boost::spawn::sharded_runtime rt{ 3, 16 };
+    rt.spawn_on( 0, caller_handler{ rt, sum, remote } );
+    rt.join();
+    BOOST_CHECK_EQUAL(999u * 1000u / 2u, sum);
+    BOOST_CHECK( remote);
+}
+
+struct throwing_handler {
+    boost::spawn::sharded_runtime & rt;
+    bool &                          caught;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        try {
+            rt.call_on( 1, [] { throw std::runtime_error{ "shard 1" }; }, yield);
+        } catch ( std::runtime_error const&) {
+            caught = true;
+        }
+    }
+};
+
+void callOnException() {
+    bool caught = false;
+    boost::spawn::sharded_runtime rt{ 2 };
+    rt.spawn_on( 0, throwing_handler{ rt, caught } );
+    rt.join();
+    BOOST_CHECK( caught);
+}
+
+struct outside_handler {
+    boost::spawn::sharded_runtime & rt;
+    int &                           value;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        value = rt.call_on( 1, [this] { return static_cast< int >( rt.current_shard() ) + 41; }, yield);
+    }
+};
+
+void callOnFromOutside() {
+    int value = 0;
+    boost::spawn::sharded_runtime rt{ 2 };
+    boost::asio::io_context ioc;
+    boost::spawn_fiber( ioc, outside_handler{ rt, value } );
+    ioc.run();
+    rt.join();
+    BOOST_CHECK_EQUAL(42, value);
+}
+
+struct ping_handler {
+    boost::spawn::sharded_runtime & rt;
+    std::atomic< int > &            calls;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        const std::size_t self = rt.current_shard();
+        for ( int i = 0; i < 500; ++i) {
+            rt.call_on( ( self + 1) % rt.size(), [this] { ++calls; }, yield);
+        }
+    }
+};
+
+void callOnAllToAll() {
+    std::atomic< int > calls{ 0 };
+    boost::spawn::sharded_runtime rt{ 4, 4 };
+    for ( std::size_t i = 0; i < rt.size(); ++i) {
+        for ( int j = 0; j < 10; ++j) {
+            rt.spawn_on( i, ping_handler{ rt, calls } );
+        }
+    }
+    rt.join();
+    BOOST_CHECK_EQUAL(4 * 10 * 500, calls.load() );
+}
+
+boost::unit_test::test_suite * init_unit_test_suite( int, char* []) {
+    boost::unit_test::test_suite * test =
+        BOOST_TEST_SUITE("Boost.Spawn: sharded runtime test suite");
+    test->add( BOOST_TEST_CASE( & spawnOn) );
+    test->add( BOOST_TEST_CASE( & callOn) );
+    test->add( BOOST_TEST_CASE( & callOnException) );
+    test->add( BOOST_TEST_CASE( & callOnFromOutside) );
+    test->add( BOOST_TEST_CASE( & callOnAllToAll) );
+    return test;
+}
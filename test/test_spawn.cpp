@@ -5,9 +5,14 @@
 //    (See accompanying file LICENSE_1_0.txt or copy at
 //          http://www.boost.org/LICENSE_1_0.txt)
 
+#include <atomic>
+#include <thread>
+#include <vector>
+
 #include <boost/spawn.hpp>
 
 #include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
 #include <boost/asio/system_timer.hpp>
 #include <boost/context/protected_fixedsize_stack.hpp>
 #include <boost/optional.hpp>
@@ -54,6 +59,19 @@ static_assert(yield_returns<std::pair<int, std::string>,
                             void(boost::system::error_code, std::pair<int, std::string>) >::value,
               "wrong return value for void(error_code, std::tuple<int>)");
 
+// as_result() wraps the return value in boost::spawn::result
+template< typename T, typename Sig>
+struct yield_result_returns : std::is_same<boost::spawn::result<T>,
+    typename boost::asio::async_result<decltype(std::declval<boost::spawn::yield_context>().as_result()), Sig>::return_type> {};
+
+static_assert(yield_result_returns< void, void(boost::system::error_code) >::value,
+              "wrong return value for as_result, void(error_code)");
+static_assert(yield_result_returns<int, void(boost::system::error_code, int) >::value,
+              "wrong return value for as_result, void(error_code, int)");
+static_assert(yield_result_returns<std::tuple<int, std::string>,
+                            void(boost::system::error_code, int, std::string) >::value,
+              "wrong return value for as_result, void(error_code, int, string)");
+
 boost::context::protected_fixedsize_stack with_stack_allocator() {
     return boost::context::protected_fixedsize_stack{ 65536 };
 }
@@ -293,6 +311,217 @@ void spawnTimerDestruct() {
     BOOST_CHECK_EQUAL(0, called);
 }
 
+struct single_threaded_handler {
+    int &   count;
+
+    single_threaded_handler( int & count) :
+        count{ count } {
+    }
+
+    void operator()() {
+        ++count;
+    }
+};
+
+namespace boost {
+namespace spawn {
+
+template< typename Executor >
+struct concurrency_policy< boost::asio::executor_binder< single_threaded_handler, Executor > > {
+    using type = single_threaded;
+};
+
+}}
+
+void spawnSingleThreadedTimer() {
+    int called = 0;
+    {
+        boost::asio::io_context ioc;
+        timer_type timer{ ioc, boost::asio::chrono::hours{ 0 } };
+        boost::spawn_fiber(
+                bind_executor( ioc.get_executor(), single_threaded_handler{ called } ),
+                spawn_wait_handler{ timer } );
+        BOOST_CHECK_EQUAL(2, ioc.run() );
+        BOOST_CHECK( ioc.stopped() );
+    }
+    BOOST_CHECK_EQUAL(1, called);
+}
+
+void spawnSingleThreadedTimerDestruct() {
+    int called = 0;
+    {
+        boost::asio::io_context ioc;
+        timer_type timer{ ioc, boost::asio::chrono::hours{ 65536 } };
+        boost::spawn_fiber(
+                bind_executor( ioc.get_executor(), single_threaded_handler{ called } ),
+                spawn_wait_handler{ timer } );
+        BOOST_CHECK_EQUAL(1, ioc.run_one() );
+        BOOST_CHECK(!ioc.stopped() );
+    }
+    BOOST_CHECK_EQUAL(0, called);
+}
+
+static_assert(std::is_same<
+                boost::spawn::multi_threaded,
+                boost::spawn::concurrency_policy<
+                    boost::asio::executor_binder< void(*)(), boost::asio::strand< boost::asio::io_context::executor_type > >
+                >::type >::value,
+              "strand must select the multi_threaded policy");
+static_assert(std::is_same<
+                boost::spawn::multi_threaded,
+                boost::spawn::concurrency_policy<
+                    boost::asio::executor_binder< void(*)(), boost::asio::io_context::executor_type >
+                >::type >::value,
+              "io_context executor must select the multi_threaded policy");
+
+void spawnSingleThreadedTag() {
+    int called = 0;
+    {
+        boost::asio::io_context ioc;
+        timer_type timer{ ioc, boost::asio::chrono::hours{ 0 } };
+        boost::spawn_fiber(
+                boost::spawn::single_threaded{},
+                bind_executor( ioc.get_executor(), counting_handler{ called } ),
+                spawn_wait_handler{ timer } );
+        BOOST_CHECK_EQUAL(2, ioc.run() );
+        BOOST_CHECK( ioc.stopped() );
+    }
+    BOOST_CHECK_EQUAL(1, called);
+}
+
+void spawnSingleThreadedTagDestruct() {
+    int called = 0;
+    {
+        boost::asio::io_context ioc;
+        timer_type timer{ ioc, boost::asio::chrono::hours{ 65536 } };
+        boost::spawn_fiber(
+                boost::spawn::single_threaded{},
+                bind_executor( ioc.get_executor(), counting_handler{ called } ),
+                spawn_wait_handler{ timer },
+                with_stack_allocator() );
+        BOOST_CHECK_EQUAL(1, ioc.run_one() );
+        BOOST_CHECK(!ioc.stopped() );
+    }
+    BOOST_CHECK_EQUAL(0, called);
+}
+
+struct strand_yield_handler {
+    std::atomic< int > &    count;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > y) {
+        for ( int i = 0; i < 100; ++i) {
+            boost::asio::post( y);
+        }
+        ++count;
+    }
+};
+
+void spawnStrandMultipleThreads() {
+    boost::asio::io_context ioc{ 4 };
+    std::atomic< int > called{ 0 };
+    for ( int i = 0; i < 100; ++i) {
+        boost::spawn_fiber( ioc, strand_yield_handler{ called } );
+    }
+    std::vector< std::thread > threads;
+    for ( int i = 0; i < 4; ++i) {
+        threads.emplace_back( [&ioc] () { ioc.run(); });
+    }
+    for ( std::thread & t : threads) {
+        t.join();
+    }
+    BOOST_CHECK_EQUAL(100, called.load() );
+}
+
+typedef boost::asio::io_context::executor_type io_executor_type;
+
+static_assert(std::is_same<
+                boost::spawn::strand_yield_context< io_executor_type >,
+                boost::spawn::basic_yield_context<
+                    boost::asio::executor_binder< void(*)(), boost::asio::strand< io_executor_type > > > >::value,
+              "wrong type for strand_yield_context");
+
+struct strand_wait_handler {
+    timer_type &    timer;
+    int &           count;
+
+    void operator()( boost::spawn::strand_yield_context< io_executor_type > yield) {
+        timer.async_wait( yield);
+        ++count;
+    }
+};
+
+void spawnStrandYieldContext() {
+    boost::asio::io_context ioc;
+    timer_type timer{ ioc, boost::asio::chrono::hours{ 0 } };
+    int called = 0;
+    boost::spawn_fiber( ioc, strand_wait_handler{ timer, called } );
+    BOOST_CHECK_EQUAL(2, ioc.run() );
+    BOOST_CHECK_EQUAL(1, called);
+}
+
+struct executor_wait_handler {
+    timer_type &    timer;
+    int &           count;
+
+    void operator()( boost::spawn::executor_yield_context< io_executor_type > yield) {
+        timer.async_wait( yield);
+        ++count;
+    }
+};
+
+void spawnExecutorYieldContext() {
+    boost::asio::io_context ioc;
+    timer_type timer{ ioc, boost::asio::chrono::hours{ 0 } };
+    int called = 0;
+    boost::spawn_fiber(
+            bind_executor( ioc.get_executor(), & boost::spawn::detail::default_spawn_handler),
+            executor_wait_handler{ timer, called } );
+    BOOST_CHECK_EQUAL(2, ioc.run() );
+    BOOST_CHECK_EQUAL(1, called);
+}
+
+struct strand_free_wait_handler {
+    timer_type &    timer;
+    int &           count;
+
+    void operator()( boost::spawn::single_threaded_yield_context< io_executor_type > yield) {
+        timer.async_wait( yield);
+        ++count;
+    }
+};
+
+void spawnStrandFree() {
+    boost::asio::io_context ioc{ 1 };
+    timer_type timer{ ioc, boost::asio::chrono::hours{ 0 } };
+    int called = 0;
+    boost::spawn_fiber(
+            boost::spawn::single_threaded{},
+            ioc,
+            strand_free_wait_handler{ timer, called } );
+    boost::spawn_fiber(
+            boost::spawn::single_threaded{},
+            ioc.get_executor(),
+            strand_free_wait_handler{ timer, called },
+            with_stack_allocator() );
+    BOOST_CHECK_EQUAL(4, ioc.run() );
+    BOOST_CHECK_EQUAL(2, called);
+}
+
+void spawnStrandFreeDestruct() {
+    int called = 0;
+    {
+        boost::asio::io_context ioc{ 1 };
+        timer_type timer{ ioc, boost::asio::chrono::hours{ 65536 } };
+        boost::spawn_fiber(
+                boost::spawn::single_threaded{},
+                ioc,
+                strand_free_wait_handler{ timer, called } );
+        BOOST_CHECK_EQUAL(1, ioc.run_one() );
+    }
+    BOOST_CHECK_EQUAL(0, called);
+}
+
 using boost::system::error_code;
 
 template< typename Handler, typename ...Args >
@@ -443,6 +672,195 @@ void returnMultipleNonDefaultConstructible() {
     BOOST_CHECK(result);
 }
 
+// counts the moves of the payload
+struct counted_payload {
+    int &   moves;
+
+    explicit counted_payload( int & m) :
+        moves( m) {
+    }
+
+    counted_payload( counted_payload const&) = delete;
+
+    counted_payload( counted_payload && other) :
+        moves( other.moves) {
+        ++moves;
+    }
+
+    counted_payload & operator=( counted_payload &&) {
+        ++moves;
+        return * this;
+    }
+};
+
+struct into_payload_handler {
+    boost::optional< counted_payload > &    result;
+    int &                                   moves;
+    error_code &                            ec;
+
+    void operator()( boost::spawn::yield_context y) {
+        using Signature = void(error_code, counted_payload);
+        auto token = y[ec].into( result);
+        boost::asio::async_completion< decltype( token), Signature > init{ token };
+        init.completion_handler( boost::asio::error::eof, counted_payload{ moves } );
+        init.result.get();
+    }
+};
+
+void intoPayload() {
+    boost::asio::io_context ioc;
+    boost::optional< counted_payload > result;
+    int moves = 0;
+    error_code ec;
+    boost::spawn_fiber( ioc, into_payload_handler{ result, moves, ec } );
+    BOOST_CHECK_EQUAL(1, ioc.poll() );
+    BOOST_CHECK(result);
+    // constructed in place from the value passed to the handler
+    BOOST_CHECK_EQUAL(1, moves);
+    BOOST_CHECK(boost::asio::error::eof == ec);
+}
+
+struct into_value_handler {
+    std::size_t &   result;
+
+    void operator()( boost::spawn::yield_context y) {
+        using Signature = void(error_code, std::size_t);
+        auto token = y.into( result);
+        boost::asio::async_completion< decltype( token), Signature > init{ token };
+        post( init.completion_handler, error_code{}, std::size_t{ 42 } );
+        init.result.get();
+    }
+};
+
+void intoValue() {
+    boost::asio::io_context ioc;
+    std::size_t result = 0;
+    boost::spawn_fiber( ioc, into_value_handler{ result } );
+    BOOST_CHECK_EQUAL(2, ioc.poll() );
+    BOOST_CHECK_EQUAL(42u, result);
+}
+
+struct into_multiple_handler {
+    std::tuple< int, std::unique_ptr< int > > & result;
+
+    void operator()( boost::spawn::yield_context y) {
+        using Signature = void(int, std::unique_ptr<int>);
+        auto token = y.into( result);
+        boost::asio::async_completion< decltype( token), Signature > init{ token };
+        init.completion_handler( 42, std::unique_ptr< int >{ new int(42) } );
+        init.result.get();
+    }
+};
+
+void intoMultipleMoveOnly() {
+    boost::asio::io_context ioc;
+    std::tuple< int, std::unique_ptr< int > > result;
+    boost::spawn_fiber( ioc, into_multiple_handler{ result } );
+    BOOST_CHECK_EQUAL(1, ioc.poll() );
+    BOOST_CHECK_EQUAL(42, std::get<0>(result) );
+    BOOST_CHECK(std::get<1>(result) );
+    BOOST_CHECK_EQUAL(42, *std::get<1>(result) );
+}
+
+struct into_throwing_handler {
+    std::size_t &   result;
+    bool &          caught;
+
+    void operator()( boost::spawn::yield_context y) {
+        using Signature = void(error_code, std::size_t);
+        auto token = y.into( result);
+        boost::asio::async_completion< decltype( token), Signature > init{ token };
+        post( init.completion_handler, error_code{ boost::asio::error::eof }, std::size_t{ 7 } );
+        try {
+            init.result.get();
+        } catch ( boost::system::system_error const& e) {
+            caught = boost::asio::error::eof == e.code();
+        }
+    }
+};
+
+void intoThrow() {
+    boost::asio::io_context ioc;
+    std::size_t result = 0;
+    bool caught = false;
+    boost::spawn_fiber( ioc, into_throwing_handler{ result, caught } );
+    BOOST_CHECK_EQUAL(2, ioc.poll() );
+    BOOST_CHECK(caught);
+    // the value is stored even if the operation fails
+    BOOST_CHECK_EQUAL(7u, result);
+}
+
+struct as_result_handler {
+    boost::optional< boost::spawn::result< std::size_t > > &  result;
+
+    void operator()( boost::spawn::yield_context y) {
+        using Signature = void(error_code, std::size_t);
+        auto token = y.as_result();
+        boost::asio::async_completion< decltype( token), Signature > init{ token };
+        post( init.completion_handler, error_code{ boost::asio::error::eof }, std::size_t{ 7 } );
+        result = init.result.get();
+    }
+};
+
+void asResult() {
+    boost::asio::io_context ioc;
+    boost::optional< boost::spawn::result< std::size_t > > result;
+    boost::spawn_fiber( ioc, as_result_handler{ result } );
+    BOOST_CHECK_EQUAL(2, ioc.poll() );
+    BOOST_REQUIRE(result);
+    BOOST_CHECK(! * result);
+    BOOST_CHECK(boost::asio::error::eof == result->error() );
+    // the value is kept if the operation has failed
+    BOOST_CHECK_EQUAL(7u, ** result);
+    BOOST_CHECK_THROW(result->value(), boost::system::system_error);
+}
+
+struct as_result_wait_handler {
+    timer_type &    timer;
+    error_code &    ec;
+    bool &          succeeded;
+
+    void operator()( boost::spawn::yield_context y) {
+        timer.expires_after( boost::asio::chrono::milliseconds{ 1 } );
+        succeeded = timer.async_wait( y.as_result() ).has_value();
+        timer.expires_after( boost::asio::chrono::hours{ 1 } );
+        boost::asio::post( timer.get_executor(), [this]{ timer.cancel(); });
+        ec = timer.async_wait( y.as_result() ).error();
+    }
+};
+
+void asResultVoid() {
+    boost::asio::io_context ioc;
+    timer_type timer{ ioc };
+    error_code ec;
+    bool succeeded = false;
+    boost::spawn_fiber( ioc, as_result_wait_handler{ timer, ec, succeeded } );
+    ioc.run();
+    BOOST_CHECK(succeeded);
+    BOOST_CHECK(boost::asio::error::operation_aborted == ec);
+}
+
+struct as_result_moveonly_handler {
+    std::unique_ptr< int > &    result;
+
+    void operator()( boost::spawn::yield_context y) {
+        using Signature = void(error_code, int, std::unique_ptr<int>);
+        auto token = y.as_result();
+        boost::asio::async_completion< decltype( token), Signature > init{ token };
+        init.completion_handler( error_code{}, 42, std::unique_ptr< int >{ new int(42) } );
+        result = std::get< 1 >( init.result.get().value() );
+    }
+};
+
+void asResultMoveOnly() {
+    boost::asio::io_context ioc;
+    std::unique_ptr< int > result;
+    boost::spawn_fiber( ioc, as_result_moveonly_handler{ result } );
+    BOOST_CHECK_EQUAL(1, ioc.poll() );
+    BOOST_REQUIRE(result);
+    BOOST_CHECK_EQUAL(42, * result);
+}
+
 struct throwing_handler {
     template< typename T >
     void operator()( boost::spawn::basic_yield_context< T >) {
@@ -579,12 +997,28 @@ boost::unit_test::test_suite * init_unit_test_suite( int, char* []) {
     test->add( BOOST_TEST_CASE( & spawnExecutionContextStackAllocator) );
     test->add( BOOST_TEST_CASE( & spawnTimer) );
     test->add( BOOST_TEST_CASE( & spawnTimerDestruct) );
+    test->add( BOOST_TEST_CASE( & spawnSingleThreadedTimer) );
+    test->add( BOOST_TEST_CASE( & spawnSingleThreadedTimerDestruct) );
+    test->add( BOOST_TEST_CASE( & spawnSingleThreadedTag) );
+    test->add( BOOST_TEST_CASE( & spawnSingleThreadedTagDestruct) );
+    test->add( BOOST_TEST_CASE( & spawnStrandMultipleThreads) );
+    test->add( BOOST_TEST_CASE( & spawnStrandYieldContext) );
+    test->add( BOOST_TEST_CASE( & spawnExecutorYieldContext) );
+    test->add( BOOST_TEST_CASE( & spawnStrandFree) );
+    test->add( BOOST_TEST_CASE( & spawnStrandFreeDestruct) );
     test->add( BOOST_TEST_CASE( & returnSingleTuple) );
     test->add( BOOST_TEST_CASE( & returnMultiple2) );
     test->add( BOOST_TEST_CASE( & returnMultiple2MoveOnly) );
     test->add( BOOST_TEST_CASE( & returnMultiple3) );
     test->add( BOOST_TEST_CASE( & returnNonDefaultConstructible) );
     test->add( BOOST_TEST_CASE( & returnMultipleNonDefaultConstructible) );
+    test->add( BOOST_TEST_CASE( & intoPayload) );
+    test->add( BOOST_TEST_CASE( & intoValue) );
+    test->add( BOOST_TEST_CASE( & intoMultipleMoveOnly) );
+    test->add( BOOST_TEST_CASE( & intoThrow) );
+    test->add( BOOST_TEST_CASE( & asResult) );
+    test->add( BOOST_TEST_CASE( & asResultVoid) );
+    test->add( BOOST_TEST_CASE( & asResultMoveOnly) );
     test->add( BOOST_TEST_CASE( & spawnThrowInHelper) );
     test->add( BOOST_TEST_CASE( & spawnHandlerThrowInHelper) );
     test->add( BOOST_TEST_CASE( & spawnThrowAfterYield) );
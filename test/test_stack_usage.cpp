@@ -0,0 +1,92 @@
+//          Copyright Oliver Kowalke 2021.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// compiled with BOOST_SPAWN_ENABLE_STACK_PAINTING defined
+
+#include <cstddef>
+#include <string>
+
+#include <boost/spawn.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/context/fixedsize_stack.hpp>
+#include <boost/context/protected_fixedsize_stack.hpp>
+#include <boost/test/unit_test.hpp>
+
+struct shallow_handler {
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        boost::asio::post( yield);
+    }
+};
+
+template< std::size_t Size >
+struct deep_handler {
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        volatile char buffer[ Size ];
+        for ( std::size_t i = 0; i < Size; ++i) {
+            buffer[ i] = 1;
+        }
+        boost::asio::post( yield);
+        buffer[ 0] = buffer[ Size - 1];
+    }
+};
+
+void stackUsageUnknown() {
+    boost::spawn::reset_stack_usage();
+    boost::spawn::stack_usage u = boost::spawn::stack_usage_of< shallow_handler >();
+    BOOST_CHECK_EQUAL(0u, u.fibers);
+    BOOST_CHECK_EQUAL(0u, u.max_used);
+    BOOST_CHECK( boost::spawn::stack_usage_report().empty() );
+}
+
+void stackUsageMeasured() {
+    boost::spawn::reset_stack_usage();
+    boost::asio::io_context ioc;
+    boost::spawn_fiber( ioc, shallow_handler{}, boost::context::fixedsize_stack{ 65536 } );
+    boost::spawn_fiber( ioc, deep_handler< 16384 >{}, boost::context::fixedsize_stack{ 65536 } );
+    boost::spawn_fiber( ioc, deep_handler< 16384 >{}, boost::context::protected_fixedsize_stack{ 65536 } );
+    ioc.run();
+
+    boost::spawn::stack_usage shallow = boost::spawn::stack_usage_of< shallow_handler >();
+    BOOST_CHECK_EQUAL(1u, shallow.fibers);
+    BOOST_CHECK_EQUAL(65536u, shallow.stack_size);
+    BOOST_CHECK( 0u < shallow.max_used);
+    BOOST_CHECK( shallow.max_used < 16384u);
+
+    boost::spawn::stack_usage deep = boost::spawn::stack_usage_of< deep_handler< 16384 > >();
+    BOOST_CHECK_EQUAL(2u, deep.fibers);
+    BOOST_CHECK( 16384u < deep.max_used);
+    BOOST_CHECK( deep.max_used < 32768u);
+    BOOST_CHECK( deep.total_used <= 2 * deep.max_used);
+    BOOST_CHECK( std::string::npos != deep.function.find("deep_handler") );
+
+    BOOST_CHECK_EQUAL(2u, boost::spawn::stack_usage_report().size() );
+    boost::spawn::reset_stack_usage();
+    BOOST_CHECK( boost::spawn::stack_usage_report().empty() );
+}
+
+void stackUsageUnwound() {
+    boost::spawn::reset_stack_usage();
+    {
+        boost::asio::io_context ioc;
+        boost::spawn_fiber( ioc, deep_handler< 8192 >{}, boost::context::fixedsize_stack{ 65536 } );
+        ioc.run_one();
+    }
+    boost::spawn::stack_usage u = boost::spawn::stack_usage_of< deep_handler< 8192 > >();
+    BOOST_CHECK_EQUAL(1u, u.fibers);
+    BOOST_CHECK( 8192u < u.max_used);
+}
+
+boost::unit_test::test_suite * init_unit_test_suite( int, char* []) {
+    boost::unit_test::test_suite * test =
+        BOOST_TEST_SUITE("Boost.Spawn: stack usage test suite");
+    test->add( BOOST_TEST_CASE( & stackUsageUnknown) );
+    test->add( BOOST_TEST_CASE( & stackUsageMeasured) );
+    test->add( BOOST_TEST_CASE( & stackUsageUnwound) );
+    return test;
+}
@@ -0,0 +1,232 @@
+//          Copyright Oliver Kowalke 2021.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <boost/spawn.hpp>
+#include <boost/spawn/condition_variable.hpp>
+#include <boost/spawn/mutex.hpp>
+#include <boost/spawn/semaphore.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/test/unit_test.hpp>
+
+void run_threads( boost::asio::io_context & ioc, int n) {
+    std::vector< std::thread > threads;
+    for ( int i = 0; i < n; ++i) {
+        threads.emplace_back( [&ioc] { ioc.run(); });
+    }
+    for ( std::thread & t : threads) {
+        t.join();
+    }
+}
+
+void mutexTryLock() {
+    boost::spawn::mutex mtx;
+    BOOST_CHECK( mtx.try_lock() );
+    BOOST_CHECK( ! mtx.try_lock() );
+    mtx.unlock();
+    BOOST_CHECK( mtx.try_lock() );
+    mtx.unlock();
+}
+
+struct increment_handler {
+    boost::spawn::mutex &   mtx;
+    int &                   counter;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        for ( int i = 0; i < 100; ++i) {
+            mtx.lock( yield);
+            int value = counter;
+            boost::asio::post( yield); // suspend while holding the mutex
+            counter = value + 1;
+            mtx.unlock();
+        }
+    }
+};
+
+void mutexExclusion() {
+    boost::spawn::mutex mtx;
+    int counter = 0;
+    boost::asio::io_context ioc{ 4 };
+    for ( int i = 0; i < 50; ++i) {
+        boost::spawn_fiber( ioc, increment_handler{ mtx, counter } );
+    }
+    run_threads( ioc, 4);
+    BOOST_CHECK_EQUAL(5000, counter);
+    BOOST_CHECK( mtx.try_lock() );
+    mtx.unlock();
+}
+
+struct flag {
+    bool &  value;
+
+    ~flag() {
+        value = true;
+    }
+};
+
+struct hold_handler {
+    boost::spawn::mutex &   mtx;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        mtx.lock( yield);
+    }
+};
+
+struct blocked_handler {
+    boost::spawn::mutex &   mtx;
+    bool &                  unwound;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        flag f{ unwound };
+        mtx.lock( yield);
+        BOOST_ERROR("lock() must not return");
+    }
+};
+
+void mutexDestroyUnwindsWaiters() {
+    bool unwound = false;
+    boost::asio::io_context ioc;
+    std::unique_ptr< boost::spawn::mutex > mtx{ new boost::spawn::mutex{} };
+    boost::spawn_fiber( ioc, hold_handler{ * mtx } );
+    boost::spawn_fiber( ioc, blocked_handler{ * mtx, unwound } );
+    ioc.run();
+    BOOST_CHECK( ! unwound);
+    mtx.reset();
+    BOOST_CHECK( unwound);
+}
+
+struct consumer_handler {
+    boost::spawn::mutex &               mtx;
+    boost::spawn::condition_variable &  cv;
+    int &                               value;
+    int &                               seen;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        mtx.lock( yield);
+        cv.wait( mtx, yield, [this] { return 0 != value; });
+        seen += value;
+        mtx.unlock();
+    }
+};
+
+struct producer_handler {
+    boost::spawn::mutex &               mtx;
+    boost::spawn::condition_variable &  cv;
+    int &                               value;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        boost::asio::post( yield);
+        mtx.lock( yield);
+        value = 7;
+        mtx.unlock();
+        cv.notify_all();
+    }
+};
+
+void conditionVariableNotifyAll() {
+    boost::spawn::mutex mtx;
+    boost::spawn::condition_variable cv;
+    int value = 0, seen = 0;
+    boost::asio::io_context ioc{ 4 };
+    for ( int i = 0; i < 10; ++i) {
+        boost::spawn_fiber( ioc, consumer_handler{ mtx, cv, value, seen } );
+    }
+    boost::spawn_fiber( ioc, producer_handler{ mtx, cv, value } );
+    run_threads( ioc, 4);
+    BOOST_CHECK_EQUAL(70, seen);
+}
+
+struct ping_handler {
+    boost::spawn::mutex &               mtx;
+    boost::spawn::condition_variable &  cv;
+    int &                               turn;
+    int                                 self;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        for ( int i = 0; i < 100; ++i) {
+            mtx.lock( yield);
+            cv.wait( mtx, yield, [this] { return self == turn % 2; });
+            ++turn;
+            mtx.unlock();
+            cv.notify_one();
+        }
+    }
+};
+
+void conditionVariableNotifyOne() {
+    boost::spawn::mutex mtx;
+    boost::spawn::condition_variable cv;
+    int turn = 0;
+    boost::asio::io_context ioc{ 2 };
+    boost::spawn_fiber( ioc, ping_handler{ mtx, cv, turn, 0 } );
+    boost::spawn_fiber( ioc, ping_handler{ mtx, cv, turn, 1 } );
+    run_threads( ioc, 2);
+    BOOST_CHECK_EQUAL(200, turn);
+}
+
+struct limited_handler {
+    boost::spawn::semaphore &   sem;
+    std::atomic< int > &        inside;
+    std::atomic< int > &        peak;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        for ( int i = 0; i < 10; ++i) {
+            sem.acquire( yield);
+            int n = ++inside;
+            int p = peak.load();
+            while ( p < n && ! peak.compare_exchange_weak( p, n) ) {
+            }
+            boost::asio::post( yield);
+            --inside;
+            sem.release();
+        }
+    }
+};
+
+void semaphoreLimits() {
+    boost::spawn::semaphore sem{ 2 };
+    std::atomic< int > inside{ 0 }, peak{ 0 };
+    boost::asio::io_context ioc{ 4 };
+    for ( int i = 0; i < 20; ++i) {
+        boost::spawn_fiber( ioc, limited_handler{ sem, inside, peak } );
+    }
+    run_threads( ioc, 4);
+    BOOST_CHECK( peak.load() <= 2);
+    BOOST_CHECK_EQUAL(2u, sem.count() );
+}
+
+void semaphoreTryAcquire() {
+    boost::spawn::semaphore sem{ 1 };
+    BOOST_CHECK( sem.try_acquire() );
+    BOOST_CHECK( ! sem.try_acquire() );
+    sem.release( 3);
+    BOOST_CHECK_EQUAL(3u, sem.count() );
+}
+
+boost::unit_test::test_suite * init_unit_test_suite( int, char* []) {
+    boost::unit_test::test_suite * test =
+        BOOST_TEST_SUITE("Boost.Spawn: synchronization test suite");
+    test->add( BOOST_TEST_CASE( & mutexTryLock) );
+    test->add( BOOST_TEST_CASE( & mutexExclusion) );
+    test->add( BOOST_TEST_CASE( & mutexDestroyUnwindsWaiters) );
+    test->add( BOOST_TEST_CASE( & conditionVariableNotifyAll) );
+    test->add( BOOST_TEST_CASE( & conditionVariableNotifyOne) );
+    test->add( BOOST_TEST_CASE( & semaphoreLimits) );
+    test->add( BOOST_TEST_CASE( & semaphoreTryAcquire) );
+    return test;
+}
@@ -0,0 +1,243 @@
+//          Copyright Oliver Kowalke 2021.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include <boost/spawn.hpp>
+#include <boost/spawn/when_all.hpp>
+
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/local/connect_pair.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/test/unit_test.hpp>
+
+struct timers_handler {
+    boost::asio::io_context &           ioc;
+    std::chrono::milliseconds &         elapsed;
+    std::vector< boost::system::error_code > & errors;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        boost::asio::steady_timer t1{ ioc, std::chrono::milliseconds{ 50 } };
+        boost::asio::steady_timer t2{ ioc, std::chrono::milliseconds{ 50 } };
+        boost::asio::steady_timer t3{ ioc, std::chrono::milliseconds{ 50 } };
+        auto start = std::chrono::steady_clock::now();
+        auto r = boost::spawn::when_all( yield,
+                [&]( auto token) { return t1.async_wait( token); },
+                [&]( auto token) { return t2.async_wait( token); },
+                [&]( auto token) { return t3.async_wait( token); });
+        elapsed = std::chrono::duration_cast< std::chrono::milliseconds >(
+                std::chrono::steady_clock::now() - start);
+        errors.push_back( std::get< 0 >( std::get< 0 >( r) ) );
+        errors.push_back( std::get< 0 >( std::get< 1 >( r) ) );
+        errors.push_back( std::get< 0 >( std::get< 2 >( r) ) );
+    }
+};
+
+void whenAllWaitsOnce() {
+    boost::asio::io_context ioc;
+    std::chrono::milliseconds elapsed{ 0 };
+    std::vector< boost::system::error_code > errors;
+    boost::spawn_fiber( ioc, timers_handler{ ioc, elapsed, errors } );
+    ioc.run();
+    // concurrently, not one after the other
+    BOOST_CHECK( elapsed < std::chrono::milliseconds{ 140 } );
+    BOOST_REQUIRE_EQUAL(3u, errors.size() );
+    for ( boost::system::error_code const& ec : errors) {
+        BOOST_CHECK( ! ec);
+    }
+}
+
+struct read_handler {
+    boost::asio::io_context &   ioc;
+    std::string &               result;
+    std::size_t &               transferred;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        boost::asio::local::stream_protocol::socket a1{ ioc }, b1{ ioc }, a2{ ioc }, b2{ ioc };
+        boost::asio::local::connect_pair( a1, b1);
+        boost::asio::local::connect_pair( a2, b2);
+        char buf1[ 5], buf2[ 5];
+        auto r = boost::spawn::when_all( yield,
+                [&]( auto token) { return boost::asio::async_read( b1, boost::asio::buffer( buf1), token); },
+                [&]( auto token) { return boost::asio::async_read( b2, boost::asio::buffer( buf2), token); },
+                [&]( auto token) { return boost::asio::async_write( a1, boost::asio::buffer( "hello", 5), token); },
+                [&]( auto token) { return boost::asio::async_write( a2, boost::asio::buffer( "world", 5), token); });
+        static_assert( std::is_same<
+                    typename std::tuple_element< 0, decltype( r) >::type,
+                    std::tuple< boost::system::error_code, std::size_t > >::value,
+                "result of an operation completing with ( error_code, size_t)");
+        BOOST_CHECK( ! std::get< 0 >( std::get< 0 >( r) ) );
+        BOOST_CHECK( ! std::get< 0 >( std::get< 1 >( r) ) );
+        transferred = std::get< 1 >( std::get< 0 >( r) ) + std::get< 1 >( std::get< 1 >( r) )
+            + std::get< 1 >( std::get< 2 >( r) ) + std::get< 1 >( std::get< 3 >( r) );
+        result = std::string{ buf1, 5 } + std::string{ buf2, 5 };
+    }
+};
+
+void whenAllReturnsValues() {
+    boost::asio::io_context ioc;
+    std::string result;
+    std::size_t transferred = 0;
+    boost::spawn_fiber( ioc, read_handler{ ioc, result, transferred } );
+    ioc.run();
+    BOOST_CHECK_EQUAL("helloworld", result);
+    BOOST_CHECK_EQUAL(20u, transferred);
+}
+
+struct error_handler {
+    boost::asio::io_context &   ioc;
+    int &                       called;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        boost::asio::steady_timer t1{ ioc, std::chrono::hours{ 1 } };
+        boost::asio::steady_timer t2{ ioc, std::chrono::milliseconds{ 10 } };
+        t2.async_wait( [&t1]( boost::system::error_code const&) {
+            t1.cancel();
+        });
+        auto r = boost::spawn::when_all( yield,
+                [&]( auto token) { return t1.async_wait( token); },
+                [&]( auto token) { return boost::asio::post( token); },
+                [&]( auto token) { return boost::asio::post( token); });
+        BOOST_CHECK( boost::asio::error::operation_aborted == std::get< 0 >( std::get< 0 >( r) ) );
+        BOOST_CHECK( ! std::get< 0 >( std::get< 1 >( r) ) );
+        BOOST_CHECK( ! std::get< 0 >( std::get< 2 >( r) ) );
+        ++called;
+    }
+};
+
+void whenAllReportsErrors() {
+    boost::asio::io_context ioc;
+    int called = 0;
+    boost::spawn_fiber( ioc, error_handler{ ioc, called } );
+    ioc.run();
+    BOOST_CHECK_EQUAL(1, called);
+}
+
+struct throwing_handler {
+    boost::asio::io_context &   ioc;
+    bool &                      caught;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        boost::asio::steady_timer t1{ ioc, std::chrono::milliseconds{ 20 } };
+        auto start = std::chrono::steady_clock::now();
+        try {
+            boost::spawn::when_all( yield,
+                    [&]( auto token) { return t1.async_wait( token); },
+                    []( auto token) {
+                        throw std::runtime_error{ "initiation failed" };
+                        return boost::asio::post( token);
+                    });
+        } catch ( std::runtime_error const&) {
+            // the operation started first has completed
+            caught = std::chrono::milliseconds{ 20 } <= std::chrono::steady_clock::now() - start;
+        }
+    }
+};
+
+void whenAllInitiationThrows() {
+    boost::asio::io_context ioc;
+    bool caught = false;
+    boost::spawn_fiber( ioc, throwing_handler{ ioc, caught } );
+    ioc.run();
+    BOOST_CHECK( caught);
+}
+
+struct throwing_cancel_handler {
+    boost::asio::io_context &   ioc;
+    bool &                      caught;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        boost::asio::steady_timer timer{ ioc, std::chrono::hours{ 1 } };
+        try {
+            boost::spawn::when_all( yield,
+                    [&]( auto token) {
+                        token.get_cancellation_slot().assign( [&timer] { timer.cancel(); });
+                        return timer.async_wait( token);
+                    },
+                    []( auto token) {
+                        throw std::runtime_error{ "initiation failed" };
+                        return boost::asio::post( token);
+                    });
+        } catch ( std::runtime_error const&) {
+            caught = true;
+        }
+    }
+};
+
+void whenAllInitiationThrowsCancels() {
+    boost::asio::io_context ioc;
+    bool caught = false;
+    auto start = std::chrono::steady_clock::now();
+    boost::spawn_fiber( ioc, throwing_cancel_handler{ ioc, caught } );
+    ioc.run();
+    // the timer started first has been cancelled
+    BOOST_CHECK( std::chrono::steady_clock::now() - start < std::chrono::minutes{ 1 } );
+    BOOST_CHECK( caught);
+}
+
+struct post_handler {
+    boost::asio::io_context &   ioc;
+    std::atomic< int > &        completed;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        for ( int i = 0; i < 100; ++i) {
+            auto r = boost::spawn::when_all( yield,
+                    [&]( auto token) { return boost::asio::post( ioc, token); },
+                    [&]( auto token) { return boost::asio::post( ioc, token); },
+                    [&]( auto token) { return boost::asio::post( ioc, token); });
+            completed += std::tuple_size< decltype( r) >::value;
+        }
+    }
+};
+
+void whenAllMultiThreaded() {
+    boost::asio::io_context ioc{ 4 };
+    std::atomic< int > completed{ 0 };
+    for ( int i = 0; i < 20; ++i) {
+        boost::spawn_fiber( ioc, post_handler{ ioc, completed } );
+        // not bound to a strand: the completion handlers run concurrently
+        boost::spawn_fiber( boost::asio::bind_executor( ioc.get_executor(), [] {}),
+                post_handler{ ioc, completed } );
+    }
+    std::vector< std::thread > threads;
+    for ( int i = 0; i < 4; ++i) {
+        threads.emplace_back( [&ioc] { ioc.run(); });
+    }
+    for ( std::thread & t : threads) {
+        t.join();
+    }
+    BOOST_CHECK_EQUAL(40 * 100 * 3, completed.load() );
+}
+
+boost::unit_test::test_suite * init_unit_test_suite( int, char* []) {
+    boost::unit_test::test_suite * test =
+        BOOST_TEST_SUITE("Boost.Spawn: when_all test suite");
+    test->add( BOOST_TEST_CASE( & whenAllWaitsOnce) );
+    test->add( BOOST_TEST_CASE( & whenAllReturnsValues) );
+    test->add( BOOST_TEST_CASE( & whenAllReportsErrors) );
+    test->add( BOOST_TEST_CASE( & whenAllInitiationThrows) );
+    test->add( BOOST_TEST_CASE( & whenAllInitiationThrowsCancels) );
+    test->add( BOOST_TEST_CASE( & whenAllMultiThreaded) );
+    return test;
+}
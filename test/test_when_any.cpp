@@ -0,0 +1,260 @@
+//          Copyright Oliver Kowalke 2021.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include <boost/spawn.hpp>
+#include <boost/spawn/cancellation.hpp>
+#include <boost/spawn/when_any.hpp>
+
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/local/connect_pair.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/test/unit_test.hpp>
+
+void cancellationSignal() {
+    boost::spawn::cancellation_signal sig;
+    boost::spawn::cancellation_slot slot = sig.slot();
+    BOOST_CHECK( slot.is_connected() );
+    BOOST_CHECK( ! slot.has_handler() );
+    sig.emit();
+    int called = 0;
+    slot.assign( [&called] { ++called; });
+    BOOST_CHECK( slot.has_handler() );
+    sig.emit();
+    sig.emit();
+    BOOST_CHECK_EQUAL(2, called);
+    slot.clear();
+    sig.emit();
+    BOOST_CHECK_EQUAL(2, called);
+    boost::spawn::cancellation_slot unconnected;
+    BOOST_CHECK( ! unconnected.is_connected() );
+    unconnected.assign( [&called] { ++called; });
+    BOOST_CHECK( ! unconnected.has_handler() );
+}
+
+struct read_or_timeout_handler {
+    boost::asio::io_context &   ioc;
+    bool                        write_first;
+    std::size_t &               winner;
+    boost::system::error_code & read_ec;
+    boost::system::error_code & timer_ec;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        boost::asio::local::stream_protocol::socket a{ ioc }, b{ ioc };
+        boost::asio::local::connect_pair( a, b);
+        if ( write_first) {
+            boost::asio::write( a, boost::asio::buffer( "x", 1) );
+        }
+        boost::asio::steady_timer timer{ ioc, write_first ? std::chrono::hours{ 1 } : std::chrono::hours{ 0 } };
+        char buf[ 1];
+        auto r = boost::spawn::when_any( yield,
+                [&]( auto token) {
+                    token.get_cancellation_slot().assign( [&b] { b.cancel(); });
+                    return b.async_read_some( boost::asio::buffer( buf), token);
+                },
+                [&]( auto token) {
+                    token.get_cancellation_slot().assign( [&timer] { timer.cancel(); });
+                    return timer.async_wait( token);
+                });
+        winner = std::get< 0 >( r);
+        read_ec = std::get< 0 >( std::get< 1 >( r) );
+        timer_ec = std::get< 0 >( std::get< 2 >( r) );
+    }
+};
+
+void whenAnyReadWins() {
+    boost::asio::io_context ioc;
+    std::size_t winner = 2;
+    boost::system::error_code read_ec, timer_ec;
+    auto start = std::chrono::steady_clock::now();
+    boost::spawn_fiber( ioc, read_or_timeout_handler{ ioc, true, winner, read_ec, timer_ec } );
+    ioc.run();
+    BOOST_CHECK( std::chrono::steady_clock::now() - start < std::chrono::minutes{ 1 } );
+    BOOST_CHECK_EQUAL(0u, winner);
+    BOOST_CHECK( ! read_ec);
+    BOOST_CHECK( boost::asio::error::operation_aborted == timer_ec);
+}
+
+void whenAnyTimerWins() {
+    boost::asio::io_context ioc;
+    std::size_t winner = 2;
+    boost::system::error_code read_ec, timer_ec;
+    boost::spawn_fiber( ioc, read_or_timeout_handler{ ioc, false, winner, read_ec, timer_ec } );
+    ioc.run();
+    BOOST_CHECK_EQUAL(1u, winner);
+    BOOST_CHECK( boost::asio::error::operation_aborted == read_ec);
+    BOOST_CHECK( ! timer_ec);
+}
+
+struct uncancellable_handler {
+    boost::asio::io_context &   ioc;
+    std::size_t &               winner;
+    std::chrono::milliseconds & elapsed;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        boost::asio::steady_timer t1{ ioc, std::chrono::milliseconds{ 30 } };
+        boost::asio::steady_timer t2{ ioc, std::chrono::milliseconds{ 1 } };
+        auto start = std::chrono::steady_clock::now();
+        auto r = boost::spawn::when_any( yield,
+                [&]( auto token) { return t1.async_wait( token); },
+                [&]( auto token) { return t2.async_wait( token); });
+        elapsed = std::chrono::duration_cast< std::chrono::milliseconds >(
+                std::chrono::steady_clock::now() - start);
+        winner = std::get< 0 >( r);
+        BOOST_CHECK( ! std::get< 0 >( std::get< 1 >( r) ) );
+        BOOST_CHECK( ! std::get< 0 >( std::get< 2 >( r) ) );
+    }
+};
+
+void whenAnyWaitsForUncancellable() {
+    boost::asio::io_context ioc;
+    std::size_t winner = 2;
+    std::chrono::milliseconds elapsed{ 0 };
+    boost::spawn_fiber( ioc, uncancellable_handler{ ioc, winner, elapsed } );
+    ioc.run();
+    BOOST_CHECK_EQUAL(1u, winner);
+    BOOST_CHECK( std::chrono::milliseconds{ 30 } <= elapsed);
+}
+
+// a hedged request: the cancellable loser ends at once, the loser without a
+// cancellation handler delays the return until it completes by itself
+struct hedged_handler {
+    boost::asio::io_context &   ioc;
+    std::size_t &               winner;
+    std::chrono::milliseconds & elapsed;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        boost::asio::steady_timer cancellable{ ioc, std::chrono::hours{ 1 } };
+        boost::asio::steady_timer unhooked{ ioc, std::chrono::milliseconds{ 50 } };
+        boost::asio::steady_timer fast{ ioc, std::chrono::milliseconds{ 1 } };
+        auto start = std::chrono::steady_clock::now();
+        auto r = boost::spawn::when_any( yield,
+                [&]( auto token) {
+                    token.get_cancellation_slot().assign( [&cancellable] { cancellable.cancel(); });
+                    return cancellable.async_wait( token);
+                },
+                [&]( auto token) { return unhooked.async_wait( token); },
+                [&]( auto token) { return fast.async_wait( token); });
+        elapsed = std::chrono::duration_cast< std::chrono::milliseconds >(
+                std::chrono::steady_clock::now() - start);
+        winner = std::get< 0 >( r);
+        BOOST_CHECK( boost::asio::error::operation_aborted == std::get< 0 >( std::get< 1 >( r) ) );
+        BOOST_CHECK( ! std::get< 0 >( std::get< 2 >( r) ) );
+    }
+};
+
+void whenAnyUnhookedLoserDelaysReturn() {
+    boost::asio::io_context ioc;
+    std::size_t winner = 3;
+    std::chrono::milliseconds elapsed{ 0 };
+    boost::spawn_fiber( ioc, hedged_handler{ ioc, winner, elapsed } );
+    ioc.run();
+    BOOST_CHECK_EQUAL(2u, winner);
+    BOOST_CHECK( std::chrono::milliseconds{ 50 } <= elapsed);
+    BOOST_CHECK( elapsed < std::chrono::minutes{ 1 } );
+}
+
+struct throwing_handler {
+    boost::asio::io_context &   ioc;
+    bool &                      caught;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        boost::asio::steady_timer timer{ ioc, std::chrono::hours{ 1 } };
+        try {
+            boost::spawn::when_any( yield,
+                    [&]( auto token) {
+                        token.get_cancellation_slot().assign( [&timer] { timer.cancel(); });
+                        return timer.async_wait( token);
+                    },
+                    []( auto token) {
+                        throw std::runtime_error{ "initiation failed" };
+                        return boost::asio::post( token);
+                    });
+        } catch ( std::runtime_error const&) {
+            caught = true;
+        }
+    }
+};
+
+void whenAnyInitiationThrows() {
+    boost::asio::io_context ioc;
+    bool caught = false;
+    auto start = std::chrono::steady_clock::now();
+    boost::spawn_fiber( ioc, throwing_handler{ ioc, caught } );
+    ioc.run();
+    // the timer started first has been cancelled
+    BOOST_CHECK( std::chrono::steady_clock::now() - start < std::chrono::minutes{ 1 } );
+    BOOST_CHECK( caught);
+}
+
+struct race_handler {
+    boost::asio::io_context &   ioc;
+    std::atomic< int > &        won;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        for ( int i = 0; i < 100; ++i) {
+            boost::asio::steady_timer timer{ ioc, std::chrono::hours{ 1 } };
+            auto r = boost::spawn::when_any( yield,
+                    [&]( auto token) {
+                        token.get_cancellation_slot().assign( [&timer] { timer.cancel(); });
+                        return timer.async_wait( token);
+                    },
+                    [&]( auto token) { return boost::asio::post( ioc, token); },
+                    [&]( auto token) { return boost::asio::post( ioc, token); });
+            if ( 0 != std::get< 0 >( r) ) {
+                ++won;
+            }
+        }
+    }
+};
+
+void whenAnyMultiThreaded() {
+    boost::asio::io_context ioc{ 4 };
+    std::atomic< int > won{ 0 };
+    for ( int i = 0; i < 20; ++i) {
+        boost::spawn_fiber( ioc, race_handler{ ioc, won } );
+        // not bound to a strand: the completion handlers run concurrently
+        boost::spawn_fiber( boost::asio::bind_executor( ioc.get_executor(), [] {}),
+                race_handler{ ioc, won } );
+    }
+    std::vector< std::thread > threads;
+    for ( int i = 0; i < 4; ++i) {
+        threads.emplace_back( [&ioc] { ioc.run(); });
+    }
+    for ( std::thread & t : threads) {
+        t.join();
+    }
+    BOOST_CHECK_EQUAL(40 * 100, won.load() );
+}
+
+boost::unit_test::test_suite * init_unit_test_suite( int, char* []) {
+    boost::unit_test::test_suite * test =
+        BOOST_TEST_SUITE("Boost.Spawn: when_any test suite");
+    test->add( BOOST_TEST_CASE( & cancellationSignal) );
+    test->add( BOOST_TEST_CASE( & whenAnyReadWins) );
+    test->add( BOOST_TEST_CASE( & whenAnyTimerWins) );
+    test->add( BOOST_TEST_CASE( & whenAnyWaitsForUncancellable) );
+    test->add( BOOST_TEST_CASE( & whenAnyUnhookedLoserDelaysReturn) );
+    test->add( BOOST_TEST_CASE( & whenAnyInitiationThrows) );
+    test->add( BOOST_TEST_CASE( & whenAnyMultiThreaded) );
+    return test;
+}
@@ -0,0 +1,160 @@
+//          Copyright Oliver Kowalke 2021.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <thread>
+
+#include <boost/spawn.hpp>
+#include <boost/spawn/mutex.hpp>
+#include <boost/spawn/work_stealing_pool.hpp>
+
+#include <boost/asio/basic_waitable_timer.hpp>
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/test/unit_test.hpp>
+
+void runHandlers() {
+    std::atomic< int > counter{ 0 };
+    boost::spawn::work_stealing_pool pool{ 4 };
+    for ( int i = 0; i < 1000; ++i) {
+        boost::asio::post( pool.get_executor(), [&counter] {
+            counter.fetch_add( 1);
+        });
+    }
+    pool.join();
+    BOOST_CHECK_EQUAL(1000, counter.load() );
+}
+
+void dispatchInline() {
+    boost::spawn::work_stealing_pool pool{ 2 };
+    auto ex = pool.get_executor();
+    BOOST_CHECK( ! ex.running_in_this_thread() );
+    bool inlined = false;
+    boost::asio::post( ex, [ex,&inlined] {
+        bool called = false;
+        boost::asio::dispatch( ex, [&called] { called = true; });
+        inlined = called;
+    });
+    pool.join();
+    BOOST_CHECK( inlined);
+}
+
+struct blocking_handler {
+    std::atomic< bool > &   done;
+    bool &                  stolen;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T >) {
+        // occupies this thread; the other fiber has to be stolen
+        std::this_thread::sleep_for( std::chrono::milliseconds{ 200 } );
+        stolen = done.load();
+    }
+};
+
+struct quick_handler {
+    std::atomic< bool > &   done;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T >) {
+        done = true;
+    }
+};
+
+void stealWork() {
+    std::atomic< bool > done{ false };
+    bool stolen = false;
+    boost::spawn::work_stealing_pool pool{ 2 };
+    auto ex = pool.get_executor();
+    boost::asio::post( ex, [ex,&done,&stolen] {
+        // both go to the queue of this thread
+        boost::asio::post( ex, [ex,&done,&stolen] {
+            boost::spawn_fiber( ex, blocking_handler{ done, stolen } );
+        });
+        boost::asio::post( ex, [ex,&done] {
+            boost::spawn_fiber( ex, quick_handler{ done } );
+        });
+    });
+    pool.join();
+    BOOST_CHECK( done);
+    BOOST_CHECK( stolen);
+}
+
+struct migrate_handler {
+    boost::spawn::mutex &           mtx;
+    int &                           counter;
+    std::mutex &                    ids_mtx;
+    std::set< std::thread::id > &   ids;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        for ( int i = 0; i < 100; ++i) {
+            {
+                std::unique_lock< std::mutex > lk{ ids_mtx };
+                ids.insert( std::this_thread::get_id() );
+            }
+            mtx.lock( yield);
+            int value = counter;
+            boost::asio::post( yield); // suspend while holding the mutex
+            counter = value + 1;
+            mtx.unlock();
+        }
+    }
+};
+
+void migrateFibers() {
+    boost::spawn::mutex mtx;
+    int counter = 0;
+    std::mutex ids_mtx;
+    std::set< std::thread::id > ids;
+    boost::spawn::work_stealing_pool pool{ 4 };
+    for ( int i = 0; i < 50; ++i) {
+        boost::spawn_fiber( pool, migrate_handler{ mtx, counter, ids_mtx, ids } );
+    }
+    pool.join();
+    BOOST_CHECK_EQUAL(5000, counter);
+    BOOST_CHECK( 1 < ids.size() );
+}
+
+using pool_timer = boost::asio::basic_waitable_timer<
+    std::chrono::steady_clock,
+    boost::asio::wait_traits< std::chrono::steady_clock >,
+    boost::spawn::work_stealing_pool::executor_type >;
+
+struct timer_handler {
+    boost::spawn::work_stealing_pool &  pool;
+    int &                               expired;
+
+    template< typename T >
+    void operator()( boost::spawn::basic_yield_context< T > yield) {
+        pool_timer timer{ pool.get_executor() };
+        for ( int i = 0; i < 10; ++i) {
+            timer.expires_after( std::chrono::milliseconds{ 1 } );
+            timer.async_wait( yield);
+            ++expired;
+        }
+    }
+};
+
+void asyncOperations() {
+    int expired = 0;
+    boost::spawn::work_stealing_pool pool{ 2 };
+    boost::spawn_fiber( pool, timer_handler{ pool, expired } );
+    pool.join();
+    BOOST_CHECK_EQUAL(10, expired);
+}
+
+boost::unit_test::test_suite * init_unit_test_suite( int, char* []) {
+    boost::unit_test::test_suite * test =
+        BOOST_TEST_SUITE("Boost.Spawn: work stealing test suite");
+    test->add( BOOST_TEST_CASE( & runHandlers) );
+    test->add( BOOST_TEST_CASE( & dispatchInline) );
+    test->add( BOOST_TEST_CASE( & stealWork) );
+    test->add( BOOST_TEST_CASE( & migrateFibers) );
+    test->add( BOOST_TEST_CASE( & asyncOperations) );
+    return test;
+}